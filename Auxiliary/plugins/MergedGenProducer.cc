@@ -62,12 +62,15 @@ void MergedGenProducer::produce(edm::Event& event, const edm::EventSetup& setup)
     pruned_idx_map[&pr] = i;
     if (pr.status() != 1) continue;
 
+    // pack the pruned particle once; the exposers read the packed values without copying
+    pat::PackedGenParticle packedPruned(pr);
+    PackedGenParticleExposer exposedPackedPruned(packedPruned);
+
     unsigned found_matches = 0;
     for (unsigned j = 0; j < packed_handle->size(); ++j) {
       // Compare explicitly the integral values of the packed dudes
       pat::PackedGenParticle const& pk = packed_handle->at(j);
-      pat::PackedGenParticle packedPruned(pr);
-      PackedGenParticleExposer exposedPacked(pk), exposedPackedPruned(packedPruned);
+      PackedGenParticleExposer exposedPacked(pk);
       if (
         pr.pdgId() != pk.pdgId()  
         || exposedPacked.packedPt()!=exposedPackedPruned.packedPt()
@@ -34,7 +34,9 @@
 #include "DataFormats/ParticleFlowCandidate/interface/PFCandidateFwd.h"
 
 #include "SUEPProd/Auxiliary/interface/getProduct.h"
+#include "SUEPProd/Utilities/interface/EtaPhiGrid.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -83,6 +85,14 @@ private:
   edm::EDGetTokenT<CandidateView> pfCandidatesToken_;
   edm::EDGetTokenT<reco::VertexCollection> vtxToken_;
   edm::EDGetTokenT<FootprintMap> footprintMapToken_;
+
+  //! Charged hadrons associated to at least one vertex
+  EtaPhiGrid chGrid_{};
+  //! Candidate index of each chGrid_ point
+  std::vector<unsigned> chIndices_{};
+  //! Vertices associated to chGrid_ point i are chVertices_[chVertexBegin_[i]] to chVertices_[chVertexBegin_[i + 1] - 1]
+  std::vector<unsigned> chVertexBegin_{};
+  std::vector<unsigned> chVertices_{};
 };
 
 WorstIsolationProducer::WorstIsolationProducer(edm::ParameterSet const& _cfg) :
@@ -104,7 +114,7 @@ void
 WorstIsolationProducer::produce(edm::Event& _event, edm::EventSetup const&)
 {
   // Constants 
-  double const coneSizeDR2 = 0.3 * 0.3;
+  double const coneSize = 0.3;
   double const dxyMax = 0.1;
   double const dzMax  = 0.2;
 
@@ -155,8 +165,12 @@ WorstIsolationProducer::produce(edm::Event& _event, edm::EventSetup const&)
     footprintMap = getProduct(_event, footprintMapToken_);
   }
 
-  // First, group the charged hadrons by vertex
-  std::vector<std::vector<unsigned>> chIndicesByVertex(vertices.size());
+  // First, associate the charged hadrons to the vertices
+  // (buffers are reused across events; the association list is kept per charged hadron)
+  chGrid_.clear();
+  chIndices_.clear();
+  chVertexBegin_.assign(1, 0);
+  chVertices_.clear();
   for (unsigned iPF(0); iPF != pfCandidates.size(); ++iPF) {
     auto& cand(pfCandidates.at(iPF));
 
@@ -182,12 +196,21 @@ WorstIsolationProducer::produce(edm::Event& _event, edm::EventSetup const&)
       if (dz > dzMax)
         continue;
 
-      chIndicesByVertex[iV].push_back(iPF);
+      chVertices_.push_back(iV);
 
       // not breaking - allow one track to be associated with multiple vertices
     }
+
+    if (chVertices_.size() != chVertexBegin_.back()) {
+      chGrid_.add(cand.eta(), cand.phi());
+      chIndices_.push_back(iPF);
+      chVertexBegin_.push_back(chVertices_.size());
+    }
   }
 
+  // cone queries visit only the candidates around the photon direction
+  chGrid_.build();
+
   // Loop over photons
   for (unsigned iPh(0); iPh != photons.size(); ++iPh) {
     auto& photon(photons.at(iPh));
@@ -209,29 +232,29 @@ WorstIsolationProducer::produce(edm::Event& _event, edm::EventSetup const&)
       // Compute photon direction with respect to the vertex
       math::XYZVector direction(sc.x() - vtx.x(), sc.y() - vtx.y(), sc.z() - vtx.z());
 
-      // Add pT of the charged hadrons in dR cone and not in the footprint
+      // Add pT of the charged hadrons of this vertex in dR cone and not in the footprint
       double isoSum(0.);
 
-      for (unsigned iPF : chIndicesByVertex[iV]) {
-        auto& cand(pfCandidates.at(iPF));
-
-        // Check if this candidate is within the isolation cone
-        double dR2(deltaR2(direction.Eta(), direction.Phi(), cand.eta(), cand.phi()));
-        if (dR2 > coneSizeDR2)
-          continue;
-
-        auto candPtr(pfCandidates.ptrAt(iPF));
-        if (isPAT) {
-          if (isInFootprint(candPtr, patFootprint))
-            continue;
-        }
-        else {
-          if (isInFootprint(candPtr, *recoFootprint))
-            continue;
-        }
-
-        isoSum += cand.pt();
-      }
+      chGrid_.forEachInCone(direction.Eta(), direction.Phi(), coneSize, [&](unsigned iCh, double) {
+          auto vBegin(chVertices_.begin() + chVertexBegin_[iCh]);
+          auto vEnd(chVertices_.begin() + chVertexBegin_[iCh + 1]);
+          if (std::find(vBegin, vEnd, iV) == vEnd)
+            return;
+
+          unsigned iPF(chIndices_[iCh]);
+
+          auto candPtr(pfCandidates.ptrAt(iPF));
+          if (isPAT) {
+            if (isInFootprint(candPtr, patFootprint))
+              return;
+          }
+          else {
+            if (isInFootprint(candPtr, *recoFootprint))
+              return;
+          }
+
+          isoSum += pfCandidates.at(iPF).pt();
+        });
 
       if (isoSum > worstIso)
         worstIso = isoSum;
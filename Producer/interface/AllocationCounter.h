@@ -0,0 +1,42 @@
+#ifndef SUEPProd_Producer_AllocationCounter_h
+#define SUEPProd_Producer_AllocationCounter_h
+
+#include <cstddef>
+
+//! Counts heap allocations made through the global operator new
+/*!
+ * Allocations are attributed to the Counts of the Scope active on the calling thread; allocations
+ * outside of any Scope are not counted. The replacement operator new lives in AllocationCounter.cc.
+ * Like any replacement of the global operator new, it is used only if it comes first in the symbol
+ * lookup order of the process. Since the library is loaded as a plugin, this requires running with
+ * LD_PRELOAD=libSUEPProdProducer.so. isActive() tells whether the hook is in place.
+ */
+class AllocationCounter {
+ public:
+  struct Counts {
+    unsigned long long nAllocations{0};
+    unsigned long long nBytes{0};
+    //! Number of Scopes opened on these counts
+    unsigned long long nScopes{0};
+
+    void add(Counts const& other) { nAllocations += other.nAllocations; nBytes += other.nBytes; nScopes += other.nScopes; }
+  };
+
+  //! Attribute allocations on this thread to the given counts for the lifetime of the object. No-op if null.
+  class Scope {
+   public:
+    Scope(Counts*);
+    ~Scope();
+
+   private:
+    Counts* previous_{0};
+    bool const set_;
+  };
+
+  //! True if the replacement operator new is in use
+  static bool isActive();
+  //! Called from operator new
+  static void record(std::size_t);
+};
+
+#endif
@@ -75,6 +75,16 @@ class ElectronsFiller : public FillerBase {
   EffectiveAreas phCHIsoEA_;
   EffectiveAreas phNHIsoEA_;
   EffectiveAreas phPhIsoEA_;
+
+  ObjectMapHandle<reco::GsfElectron, suep::Electron> eleEleMap_{};
+  ObjectMapHandle<reco::SuperCluster, suep::Electron> scEleMap_{};
+  ObjectMapHandle<reco::Candidate, suep::Electron> pfEleMap_{};
+  ObjectMapHandle<reco::Vertex, suep::Electron> vtxEleMap_{};
+  ObjectMapHandle<reco::Candidate, suep::Electron> genEleMap_{};
+  ObjectMapHandle<reco::SuperCluster, suep::SuperCluster> scMap_{};
+  ObjectMapHandle<reco::Candidate, suep::PFCand> pfMap_{};
+  ObjectMapHandle<reco::Vertex, suep::RecoVertex> vtxMap_{};
+  ObjectMapHandle<reco::Candidate, suep::GenParticle> genMap_{};
 };
 
 #endif
@@ -0,0 +1,48 @@
+#ifndef SUEPProd_Producer_EventExtension_h
+#define SUEPProd_Producer_EventExtension_h
+
+#include "TTree.h"
+
+#include <memory>
+#include <string>
+
+//! Per-event output of a filler that is not a member of suep::Event
+/*!
+ * The filler fills its instance next to the suep::Event of its stream. Each EventWriter holds its
+ * own instances (one booked on the events tree, one per queue buffer) made with clone(), and copies
+ * the stream's instance along with the event. With a single stream and no queue, the stream's
+ * instance is booked directly.
+ */
+class EventExtension {
+ public:
+  virtual ~EventExtension() {}
+
+  //! New instance of the same kind, without content
+  virtual std::unique_ptr<EventExtension> clone() const = 0;
+  //! Copy the content of an instance of the same kind
+  virtual void copy(EventExtension const&) = 0;
+  //! Book the branches on the events tree. Called again with the new tree at an output rollover.
+  virtual void book(TTree&) = 0;
+  //! Called right before the events tree is filled
+  virtual void prepareFill(TTree&) = 0;
+};
+
+//! EventExtension holding a SUEPTree collection
+template<class Collection>
+class CollectionExtension : public EventExtension {
+ public:
+  CollectionExtension(std::string const& name, unsigned size) : collection(name.c_str(), size), name_(name), size_(size) {}
+
+  std::unique_ptr<EventExtension> clone() const override { return std::unique_ptr<EventExtension>(new CollectionExtension(name_, size_)); }
+  void copy(EventExtension const& _source) override { collection = static_cast<CollectionExtension const&>(_source).collection; }
+  void book(TTree& _tree) override { collection.book(_tree); }
+  void prepareFill(TTree& _tree) override { collection.prepareFill(_tree); }
+
+  Collection collection;
+
+ private:
+  std::string const name_;
+  unsigned const size_;
+};
+
+#endif
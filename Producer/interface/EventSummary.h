@@ -0,0 +1,39 @@
+#ifndef SUEPProd_Producer_EventSummary_h
+#define SUEPProd_Producer_EventSummary_h
+
+#include "SUEPTree/Objects/interface/Event.h"
+
+#include "TTree.h"
+
+//! Flat per-event quantities for a loose preselection without reading the events tree
+/*!
+ * The summary tree is filled by the EventWriter right after each events tree entry, so entry i of
+ * the summary corresponds to entry i of the events tree (also across output rollovers). Values are
+ * taken from the filled suep::Event; collections that are not booked give zero.
+ * Trigger bits are stored as nTriggerWords 64-bit words (bit i = index i of the HLT menu).
+ */
+class EventSummary {
+ public:
+  static unsigned const nJets = 2;
+  static unsigned const nTriggerWords = 16;
+
+  void book(TTree&);
+  void set(suep::Event const&);
+
+ private:
+  unsigned runNumber_{0};
+  unsigned lumiNumber_{0};
+  unsigned long long eventNumber_{0};
+  unsigned npv_{0};
+  unsigned nVertices_{0};
+  float chsAK4JetPt_[nJets]{};
+  float puppiAK4JetPt_[nJets]{};
+  float puppiAK8JetPt_{0.};
+  float pfMet_{0.};
+  float puppiMet_{0.};
+  unsigned nTracks_{0};
+  unsigned nPFCandidates_{0};
+  unsigned long long triggerBits_[nTriggerWords]{};
+};
+
+#endif
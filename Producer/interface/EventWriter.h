@@ -0,0 +1,306 @@
+#ifndef SUEPProd_Producer_EventWriter_h
+#define SUEPProd_Producer_EventWriter_h
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "SUEPTree/Objects/interface/Event.h"
+#include "SUEPTree/Objects/interface/Run.h"
+
+#include "LatencyHistogram.h"
+#include "AllocationCounter.h"
+#include "EventSummary.h"
+#include "EventExtension.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TH1D.h"
+#include "TString.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+//! Output side of SUEPProducer
+/*!
+ * One EventWriter exists per job and is shared by all SUEPProducer stream instances. Each stream
+ * owns its fillers, ObjectMapStore and suep::Event; once a stream has filled its event, the writer
+ * copies it into its own suep::Event (the one booked on the events tree) and fills the tree.
+ * Filler outputs that are not members of suep::Event (EventExtension, e.g. the unpacked gen
+ * particles) are registered with the event and copied along with it.
+ * With a single stream and no queue, the events tree is booked on the stream's suep::Event instead
+ * and filled without a copy. The choice is made when the first event is written, after all streams
+ * have called book(); the event branches are booked at that point.
+ * The signal reweighting factors (genReweight.genParam) are written by the writer as well: their
+ * number is known only at the end of the learning phase of the WeightsFiller, so the values of the
+ * events written until then are kept and backfilled when the first stream sets the ids. The ids go
+ * to a "weights" tree in each file.
+ * All operations on the output file are serialized by the writer mutex.
+ * With outputQueueSize > 0, fillEvent only copies the event and its extensions into one of
+ * outputQueueSize buffers and returns; a dedicated thread fills the events tree (serialization and
+ * compression) from the buffers in order. fillEvent blocks while all buffers are waiting to be written.
+ * Compression is given as "ALGORITHM:level" (ZLIB, LZMA, LZ4, or ZSTD with ROOT >= 6.20) for the
+ * whole file and optionally per events tree branch ("branch=ALGORITHM:level"; the setting also
+ * applies to the sub-branches "branch.*"). Basket sizes start at basketSize and are resized by
+ * ROOT (TTree::OptimizeBaskets) according to the observed branch sizes at the first flush. Nothing
+ * is derived here; collections whose size is known in advance can be given a fixed basket size with
+ * branchBasketSize ("branch=bytes", also for "branch.*"); these are re-applied after the first flush.
+ * autoFlush sets the cluster size of the events tree (> 0: events, < 0: compressed bytes).
+ * With maxEventsPerFile or maxFileSize (MB) set, the output rolls over to a new file (suep_1.root,
+ * suep_2.root, ...) at the end of the luminosity block in which the limit is reached. Each file has
+ * its own runs, lumiSummary and eventcounter content; the streams re-create the filler outputs
+ * (hlt tree, histograms) in the new file through the rollover callbacks. The rollover requires
+ * numberOfConcurrentLuminosityBlocks = 1 (checked by SUEPProducer); otherwise other streams could
+ * already have written events of the next lumi to the closing file.
+ * With convertToRNTuple set, the events tree of each output file is converted to an RNTuple
+ * ("events") in a companion file (ROOT >= 6.30). This is a converter, not an output backend: events
+ * are written as TTree, and close() reads the closed files back with RNTupleImporter (without
+ * holding the writer mutex), so the output is read and compressed a second time at endJob.
+ * The RNTuple has the same fields as the booked branches, so the branch selection of the fillers and
+ * dropBranches applies.
+ * With writeSummary = True, a small "summary" tree (see EventSummary) is filled alongside the events
+ * tree, entry by entry, for preselection without reading the full events.
+ * Each lumiSummary entry records the first and last events tree entry of the lumi (-1 if no event
+ * was written). With one concurrent lumi, the events of a lumi are contiguous and the "entries"
+ * list is empty. With concurrent lumis, events of neighbouring lumis can be interleaved; the entries
+ * of the lumi are then listed in "entries", and first/last only bound them. With buildEventIndex = True, a TTreeIndex on
+ * (runNumber, eventNumber) is built on the events tree before each file is closed.
+ * With reportBranchSizes = True, the compressed and uncompressed sizes of the events tree branches
+ * (grouped by collection and by the filler declaring it) are saved in a "branchSizes" tree in each
+ * file and summed over the job in a report printed at endJob.
+ */
+class EventWriter {
+ public:
+  typedef std::chrono::steady_clock::duration Duration;
+  //! Called with the output file during a rollover, with the writer mutex locked
+  typedef std::function<void(TFile&)> RolloverCallback;
+
+  EventWriter(edm::ParameterSet const&);
+  ~EventWriter();
+
+  //! Open the output file and create the trees. Called once at beginJob.
+  void open();
+  //! Register the event of a stream and its extensions, and book the run tree. Only the first call books (all streams have identical fillers).
+  void book(suep::Event& streamEvent, std::vector<EventExtension*> const& extensions, suep::utils::BranchList const& eventBranches, suep::utils::BranchList const& runBranches);
+  //! Names of the fillers and the branches they declare, used to group the branch size report. Only the first call has an effect.
+  void setBranchOwners(std::vector<std::pair<std::string, suep::utils::BranchList>> const&);
+  //! Write out all objects and close the file. Called once at endJob.
+  void close();
+
+  TFile* getOutputFile() const { return outputFile_; }
+  //! True if maxEventsPerFile or maxFileSize is set
+  bool rollsOver() const { return maxEventsPerFile_ != 0 || maxFileSize_ != 0; }
+  //! Lock this mutex when touching objects in the output file from a stream (addOutput, run transitions).
+  std::mutex& getMutex() { return mutex_; }
+
+  //! Count an event in the eventcounter histogram.
+  void countEvent(bool selected);
+  //! Fill the events tree with the event (or queue a copy of it for the writer thread).
+  void fillEvent(suep::Event&);
+  //! Fill the runs tree. The first stream to finish a run writes it; later calls for the same run are ignored.
+  void fillRun(suep::Run const&);
+  //! Copy of the run in progress, written to the runs tree of a file closed at a rollover
+  void setCurrentRun(suep::Run const&);
+  //! Fill the lumiSummary tree, including the range of events tree entries of the lumi. Call when all streams are done with the lumi.
+  void fillLumiSummary(unsigned run, unsigned lumi, unsigned nEvents);
+
+  //! Add the histograms a stream filled in its scratch directory to their counterparts in the output file.
+  void mergeStreamOutput(TDirectory&);
+  //! Declare that the events carry genReweight.genParam. The values are kept from now on until the ids are set.
+  void expectGenParam();
+  //! Set the ids of genReweight.genParam at the end of the learning phase of a stream. The first call fixes them for the job; the branch is booked at the next event or file closure. Safe to call with the writer mutex locked.
+  void setGenParamIds(std::vector<TString> const&);
+  //! Add a histogram of a stream to its counterpart. Bins are matched by index; labeled bins appended during the job (signal weights in hSumW) can make the source longer, and the target is extended.
+  static void addHistogram(TH1& target, TH1 const& source);
+  //! Copy the histograms and trees the fillers created in the output file of another writer (other than the event, run and lumi trees). Called before close().
+  void copyAuxiliaryObjects(EventWriter&);
+  //! Register functions called before the current file is closed and after the new file is opened at a rollover
+  void addRolloverClient(RolloverCallback const& beforeClose, RolloverCallback const& afterOpen);
+  //! Close the file and open the next one if a limit is reached. Call only at luminosity block boundaries (no events in flight).
+  bool rolloverIfDue();
+  //! Accumulate the filler timers of a stream. The last timer is the "Other CMSSW" time.
+  void addTimers(std::vector<std::string> const& names, std::vector<Duration> const& timers, unsigned long long nEvents);
+  //! Accumulate the latency distributions of a stream, labeled by (name, phase). Written to the "timing" directory if recordTiming = True.
+  void addLatencies(std::vector<std::pair<std::string, std::string>> const& labels, std::vector<LatencyHistogram> const&);
+  //! Accumulate the allocation counts of a stream, labeled by (name, phase). Printed at close.
+  void addAllocations(std::vector<std::pair<std::string, std::string>> const& labels, std::vector<AllocationCounter::Counts> const&);
+
+ private:
+  //! Copy to the booked event (and extensions) unless it is the booked event, and fill the events tree
+  void fillTree_(suep::Event&, std::vector<EventExtension*> const&);
+  //! Extensions registered with the event of a stream
+  std::vector<EventExtension*> const& streamExtensions_(suep::Event const&) const;
+  //! Book the genParam branch and the weights tree in the current file and backfill the kept values. Call with genParamMutex_ locked.
+  void bookGenParam_();
+  //! Choose the event to book on the events tree and book it
+  void bookEventTree_();
+  void fillRun_(suep::Run const&);
+  void mergeStreamOutput_(TDirectory&);
+  //! Open the output file with index fileIndex_ and create (and book) the trees
+  void openFile_();
+  //! Write the eventcounter and all objects in the file, and close it
+  void closeFile_();
+  //! Output file name with the rollover index inserted
+  std::string indexedName_(std::string const&) const;
+  //! Convert the events tree of one closed output file to an RNTuple
+  void writeRNTuple_(std::string const& sourceName, std::string const& destName) const;
+  //! Block until the writer thread has filled all queued events
+  void waitForQueue_();
+  //! Main function of the writer thread
+  void writeLoop_();
+  void stopWriter_();
+  void printTimers_() const;
+  void printAllocations_() const;
+  //! Write the branchSizes tree of the events tree in the current file and add to the job totals
+  void recordBranchSizes_();
+  void printBranchSizes_() const;
+  void writeLatencies_();
+  //! Apply per-branch compression, basket size and auto-flush settings to the events tree
+  void configureEventTree_();
+  //! Apply the setting to the branches named branch or branch.*. Returns the number of matched branches.
+  unsigned forEachMatchingBranch_(std::string const& name, std::function<void(TBranch&)> const&);
+  //! Re-apply branchBasketSize after the first flush
+  void restoreBasketSizes_();
+  //! Apply basketSize and the matching per-branch settings to a branch booked after the others
+  void configureBranch_(TBranch&);
+  //! True if the branch is the named one or one of its sub-branches (name.*)
+  static bool matchesBranch_(std::string const& name, std::string const& branchName);
+
+  //! ROOT compression settings (100 * algorithm + level) from "ALGORITHM:level"
+  static int parseCompression_(std::string const&);
+
+  std::string const outputName_;
+  unsigned const printLevel_;
+  unsigned const queueSize_;
+  bool const recordTiming_;
+  int const compression_;
+  std::vector<std::pair<std::string, int>> branchCompression_{};
+  int const basketSize_;
+  std::vector<std::pair<std::string, int>> branchBasketSizes_{};
+  bool basketSizesRestored_{true};
+  long long const autoFlush_;
+  unsigned const maxEventsPerFile_;
+  long long const maxFileSize_; //! in bytes
+  std::string const rntupleName_;
+  bool const writeSummary_;
+  bool const buildEventIndex_;
+  bool const reportBranchSizes_;
+
+  std::mutex mutex_;
+
+  TFile* outputFile_{0};
+  TTree* eventTree_{0};
+  TTree* runTree_{0};
+  TTree* lumiSummaryTree_{0};
+  TH1D* eventCounter_{0};
+  TTree* summaryTree_{0};
+  suep::Event outEvent_;
+  //! Event booked on the events tree: outEvent_, or the stream's event if it is the only one and there is no queue. Null until the first event.
+  suep::Event* bookedEvent_{0};
+  EventSummary summary_{};
+
+  bool booked_{false};
+  //! Event of a stream and the extensions registered with it
+  struct StreamEvent {
+    suep::Event* event;
+    std::vector<EventExtension*> extensions;
+  };
+  std::vector<StreamEvent> streamEvents_{};
+  //! Writer-owned copies of the extensions of the streams
+  std::vector<std::unique_ptr<EventExtension>> outExtensions_{};
+  //! Extensions booked on the events tree: outExtensions_ or the stream's, following bookedEvent_
+  std::vector<EventExtension*> bookedExtensions_{};
+  suep::utils::BranchList eventBranches_{};
+  suep::utils::BranchList runBranches_{};
+  std::set<unsigned> writtenRuns_{};
+  suep::Run currentRun_{};
+
+  bool genParamExpected_{false};
+  //! True while the genParam values of the written events are kept (ids not known yet)
+  bool genParamPending_{false};
+  //! genParam of the events of the current file written while pending, NMAX values per event
+  std::vector<float> pendingGenParam_{};
+  TBranch* genParamBranch_{0};
+  unsigned nGenParam_{0}; //! number of values in the genParam branch
+  TTree* weightsTree_{0};
+  float genParam_[suep::GenReweight::NMAX]{};
+  //! Guards the ids; taken without the writer mutex by setGenParamIds
+  std::mutex genParamMutex_;
+  bool genParamIdsSet_{false};
+  std::vector<TString> genParamIds_{};
+
+  unsigned fileIndex_{0};
+  unsigned long long nEventsInFile_{0};
+  unsigned long long nAllAtOpen_{0};
+  unsigned long long nSelectedAtOpen_{0};
+  std::vector<std::pair<RolloverCallback, RolloverCallback>> rolloverClients_{};
+  //! (output file, RNTuple file) of the closed files, converted in close()
+  std::vector<std::pair<std::string, std::string>> rntupleConversions_{};
+
+  unsigned lumiRunNumber_{0};
+  unsigned lumiNumber_{0};
+  unsigned nEventsInLumi_{0};
+  long long lumiFirstEntry_{-1};
+  long long lumiLastEntry_{-1};
+  std::vector<long long> lumiEntryList_{};
+  //! Events tree entries of a lumi. entries is filled only once the entries stop being contiguous.
+  struct LumiEntries {
+    long long first;
+    long long last;
+    std::vector<long long> entries;
+  };
+  //! (run, lumi) -> entries of the lumis not yet in lumiSummary
+  std::map<std::pair<unsigned, unsigned>, LumiEntries> lumiEntries_{};
+
+  std::atomic<unsigned long long> nAll_{0};
+  std::atomic<unsigned long long> nSelected_{0};
+
+  std::thread writerThread_{};
+  std::mutex queueMutex_;
+  std::condition_variable queuedCondition_; //! signals the writer thread
+  std::condition_variable freeCondition_; //! signals the streams waiting for a buffer
+  //! Copy of an event and its extensions waiting for the writer thread
+  struct Buffer {
+    suep::Event event{};
+    std::vector<std::unique_ptr<EventExtension>> ownedExtensions{};
+    std::vector<EventExtension*> extensions{};
+  };
+  std::vector<std::unique_ptr<Buffer>> buffers_{};
+  std::deque<Buffer*> freeBuffers_{};
+  std::deque<Buffer*> queuedEvents_{};
+  bool stopRequested_{false};
+  std::exception_ptr writerError_{};
+
+  std::vector<std::string> timerNames_{};
+  std::vector<Duration> timers_{};
+  unsigned long long nTimedEvents_{0};
+  unsigned long long nOtherEvents_{0}; //! number of intervals measured by the "Other CMSSW" timer
+  Duration outputTime_{Duration::zero()}; //! time spent in filling the events tree
+  unsigned long long nOutputEvents_{0};
+
+  std::vector<std::pair<std::string, std::string>> latencyLabels_{};
+  std::vector<LatencyHistogram> latencies_{};
+  LatencyHistogram outputLatency_{};
+
+  std::vector<std::pair<std::string, suep::utils::BranchList>> branchOwners_{};
+  //! Branch name (up to the first '.') -> (filler, compressed bytes, uncompressed bytes), summed over files
+  std::map<std::string, std::tuple<std::string, long long, long long>> branchSizes_{};
+  unsigned long long nBranchSizeEvents_{0};
+
+  std::vector<std::pair<std::string, std::string>> allocationLabels_{};
+  std::vector<AllocationCounter::Counts> allocations_{};
+};
+
+#endif
@@ -24,6 +24,7 @@ class FatJetsFiller : public JetsFiller {
   ~FatJetsFiller();
 
   void branchNames(suep::utils::BranchList& eventBranches, suep::utils::BranchList&) const override;
+  void setBookedBranches(suep::utils::BranchList const& eventBranches, suep::utils::BranchList const&) override;
 
  protected:
   void fillDetails_(suep::Event&, edm::Event const&, edm::EventSetup const&) override;
@@ -49,6 +50,8 @@ class FatJetsFiller : public JetsFiller {
   fastjet::contrib::SoftDrop* softdrop_{0};
   fastjet::contrib::Njettiness* tau_{0};
   fastjet::HEPTopTaggerV2* htt_{0};
+  //! clustering input, reused across jets and events (fastjet takes std::vector and cannot use the arena)
+  std::vector<fastjet::PseudoJet> constituents_{};
   suepecf::Calculator *ecfcalc_{0};
 
   enum SubstructureComputeMode {
@@ -62,6 +65,9 @@ class FatJetsFiller : public JetsFiller {
   OutSubjetSelector outSubjetSelector_{};
 
   SubstructureComputeMode computeSubstructure_{kNever};
+  bool fillSubjets_{true};
+  //! targets: subjets of the current event
+  EtaPhiMatcher subjetMatcher_;
 };
 
 #endif
@@ -11,11 +11,25 @@
 #include "SUEPTree/Objects/interface/Event.h"
 #include "SUEPTree/Objects/interface/Run.h"
 #include "ObjectMap.h"
+#include "PFCandidateIndex.h"
+#include "PFCandidateSnapshot.h"
 
 #include "TFile.h"
 
 #include "tbb/concurrent_unordered_map.h"
 
+#include <boost/container/pmr/map.hpp>
+#include <boost/container/pmr/monotonic_buffer_resource.hpp>
+#include <boost/container/pmr/vector.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+class JetCorrectionsCache;
+class EventExtension;
+class EventWriter;
+
 typedef std::vector<std::string> VString;
 typedef std::vector<std::vector<std::string>> VVString;
 
@@ -23,6 +37,10 @@ typedef std::vector<std::vector<std::string>> VVString;
 /*!
  * There is no strict (programmatic) rule on the scope of each Filler. One basic guideline is to
  * define one Filler per object branch (collection etc.) of the Event.
+ * Each stream instance of SUEPProducer constructs its own set of Fillers. Fillers therefore may keep
+ * per-event state in members, but must not share mutable state through globals or statics.
+ * Temporary containers of fill() and setRefs() should be allocated from the per-event arena
+ * (ScratchVector, ScratchMap, getArena_()), which is released in one go after the event is written.
  */
 class FillerBase {
  public:
@@ -31,8 +49,18 @@ class FillerBase {
 
   //! Add names of branches the filler wants to book. If nothing is specified, all branches are booked.
   virtual void branchNames(suep::utils::BranchList& eventBranches, suep::utils::BranchList& runBranches) const {}
-  //! Override when the filler writes additional objects to the output file
+  //! Called once the output branch list is final. Override to skip computing outputs that are not booked.
+  virtual void setBookedBranches(suep::utils::BranchList const& eventBranches, suep::utils::BranchList const& runBranches) {}
+  //! Add the per-event outputs of the filler that are not members of suep::Event. The writers book and copy them along with the event.
+  virtual void eventExtensions(std::vector<EventExtension*>&) {}
+  //! Called at the beginning of the stream with the writers of all outputs (the primary first)
+  virtual void setEventWriters(std::vector<EventWriter*> const&) {}
+  //! Override when the filler writes additional objects to the output file. Called again with the new file at an output rollover.
   virtual void addOutput(TFile&) {}
+  //! Called before the output file is closed at a rollover. Flush anything the closing file must contain.
+  virtual void beforeRollover(suep::Run&) {}
+  //! Called after addOutput() with the new file at a rollover, in the middle of a run
+  virtual void afterRollover(suep::Run&) {}
   //! Main function
   virtual void fill(suep::Event&, edm::Event const&, edm::EventSetup const&) = 0;
   //! Set references
@@ -49,15 +77,47 @@ class FillerBase {
   std::string const& getName() const { return fillerName_; }
   bool enabled() const { return enabled_; }
   void setObjectMap(FillerObjectMap& map) { objectMap_ = &map; }
+  //! Resolve the registered ObjectMapHandles. Called once all fillers are constructed.
+  void resolveObjectMaps(ObjectMapStore&);
+  //! Names of the fillers whose ObjectMaps are read in setRefs(). Each filler produces the ObjectMap under its own name.
+  VString const& getRefDependencies() const { return refDependencies_; }
+  //! Names of resources that may not be used by two fillers at the same time
+  VString const& getSharedResources() const { return sharedResources_; }
+  //! Set when fillers run concurrently; serializes access to edm::Event and edm::EventSetup
+  void setFrameworkMutex(std::mutex* mutex) { frameworkMutex_ = mutex; }
+  //! Set by SUEPProducer; the snapshot and the index are shared by all fillers of the stream
+  void setPFCandidateCache(PFCandidateSnapshotStore* snapshots, PFCandidateIndex* index) { pfCandidateSnapshot_ = snapshots; pfCandidateIndex_ = index; }
+  //! Set by SUEPProducer; shared by all fillers of the stream
+  void setJetCorrectionsCache(JetCorrectionsCache* cache) { jetCorrectionsCache_ = cache; }
+  //! Free everything allocated from the arena. Called after the event is written.
+  void releaseArena() { arena_.release(); }
 
  private:
   std::string const fillerName_;
   bool const enabled_;
+  VString refDependencies_{};
+  VString sharedResources_{};
+  std::mutex* frameworkMutex_{0};
+  PFCandidateSnapshotStore* pfCandidateSnapshot_{0};
+  PFCandidateIndex* pfCandidateIndex_{0};
+  JetCorrectionsCache* jetCorrectionsCache_{0};
+  std::vector<std::function<void(ObjectMapStore&)>> mapResolvers_{};
+  unsigned const arenaSize_; // initial arena buffer in bytes; the arena falls back to the heap beyond this
+  std::unique_ptr<char[]> arenaBuffer_;
+  boost::container::pmr::monotonic_buffer_resource arena_;
 
  protected:
   template <class Product>
   using NamedToken = std::pair<std::string, edm::EDGetTokenT<Product>>;
 
+  typedef boost::container::pmr::memory_resource MemoryResource;
+  //! vector allocated from the arena. Construct with getArena_().
+  template <class T>
+  using ScratchVector = boost::container::pmr::vector<T>;
+  //! map allocated from the arena. Construct with getArena_().
+  template <class K, class V>
+  using ScratchMap = boost::container::pmr::map<K, V>;
+
   //! get a parameter in the "global" (i.e. PSet for SUEPProducer) scope. Use dots to descend into sub-PSets
   template<class T>
   static T getGlobalParameter_(edm::ParameterSet const&, std::string const&);
@@ -133,6 +193,29 @@ class FillerBase {
   template<class Principal, class Product>
   Product const* getProductSafe_(Principal const&, NamedToken<Product> const&, edm::Handle<Product>* = 0);
 
+  //! declare that setRefs() reads the ObjectMap of the named filler (after its fill() and setRefs())
+  void consumesObjectMap_(std::string const& fillerName) { refDependencies_.push_back(fillerName); }
+  //! register a handle to an ObjectMap of this filler
+  template<class EDM, class PANDA>
+  void registerObjectMap_(ObjectMapHandle<EDM, PANDA>&, std::string const& label = "");
+  //! register a handle to an ObjectMap of another filler read in setRefs(); implies consumesObjectMap_(fillerName)
+  template<class EDM, class PANDA>
+  void consumesObjectMap_(ObjectMapHandle<EDM, PANDA>&, std::string const& fillerName, std::string const& label = "");
+  //! declare the use of a resource shared with other fillers (e.g. the stream random number engine)
+  void usesSharedResource_(std::string const& name) { sharedResources_.push_back(name); }
+  //! true if the branch (e.g. "tracks" or "puppiAK8Jets.ecfs") is written out according to the list
+  static bool isBooked_(suep::utils::BranchList const&, std::string const& branchName);
+  //! lock before accessing edm::Event or edm::EventSetup directly (getProduct_ does it internally)
+  std::unique_lock<std::mutex> lockFramework_() const;
+  //! eta-phi index of a PF candidate collection in this event (built on first use per collection, shared with the other fillers)
+  EtaPhiGrid const& getPFCandidateIndex_(reco::CandidateView const& candidates) { return pfCandidateIndex_->get(getPFCandidateSnapshot_(candidates)); }
+  //! single-pass digest of a PF candidate collection in this event (filled on first use per collection, shared with the other fillers)
+  PFCandidateSnapshot const& getPFCandidateSnapshot_(reco::CandidateView const& candidates) { return pfCandidateSnapshot_->get(candidates); }
+  //! JEC uncertainty parameters and JER objects of the current IOV (call with the framework lock held)
+  JetCorrectionsCache& getJetCorrectionsCache_() const { return *jetCorrectionsCache_; }
+  //! per-event memory arena (not thread safe; each filler has its own)
+  MemoryResource* getArena_() { return &arena_; }
+
   FillerObjectMap* objectMap_{0};
 
   bool isRealData_;
@@ -192,6 +275,26 @@ FillerBase::getTokenImpl_(NamedToken<Product>& _token, edm::ParameterSet const&
     _token.second = _coll.consumes<Product, B>(edm::InputTag(paramValue));
 }
 
+template<class EDM, class PANDA>
+void
+FillerBase::registerObjectMap_(ObjectMapHandle<EDM, PANDA>& _handle, std::string const& _label/* = ""*/)
+{
+  _handle.fillerName = getName();
+  _handle.label = _label;
+  mapResolvers_.emplace_back([&_handle](ObjectMapStore& store) { _handle.resolve(store); });
+}
+
+template<class EDM, class PANDA>
+void
+FillerBase::consumesObjectMap_(ObjectMapHandle<EDM, PANDA>& _handle, std::string const& _fillerName, std::string const& _label/* = ""*/)
+{
+  consumesObjectMap_(_fillerName);
+
+  _handle.fillerName = _fillerName;
+  _handle.label = _label;
+  mapResolvers_.emplace_back([&_handle](ObjectMapStore& store) { _handle.resolve(store); });
+}
+
 template<class Principal, class Product>
 Product const&
 FillerBase::getProduct_(Principal const& _prn, NamedToken<Product> const& _token, edm::Handle<Product>* _handle/* = 0*/)
@@ -201,6 +304,7 @@ FillerBase::getProduct_(Principal const& _prn, NamedToken<Product> const& _token
   if (!handlePtr)
     handlePtr = &handle;
 
+  auto lock(lockFramework_());
   if (!_prn.getByToken(_token.second, *handlePtr))
     throw cms::Exception("ProductNotFound") << "fillers." << getName() << "." << _token.first;
 
@@ -219,6 +323,7 @@ FillerBase::getProductSafe_(Principal const& _prn, NamedToken<Product> const& _t
   if (!handlePtr)
     handlePtr = &handle;
 
+  auto lock(lockFramework_());
   if (!_prn.getByToken(_token.second, *handlePtr))
     return 0;
 
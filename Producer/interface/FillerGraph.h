@@ -0,0 +1,40 @@
+#ifndef SUEPProd_Producer_FillerGraph_h
+#define SUEPProd_Producer_FillerGraph_h
+
+#include "FillerBase.h"
+
+#include "tbb/flow_graph.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+//! Runs fill() and setRefs() of the fillers of one stream as a TBB flow graph
+/*!
+ * Nodes of the graph are the fill and setRefs steps of each filler. Edges are
+ *  . fill(F) -> setRefs(F)
+ *  . setRefs(P) -> setRefs(F) for each P in F.getRefDependencies()
+ *  . fill(A) -> fill(B) when A and B share a resource and A precedes B in the filler list
+ * Steps without a path between them can run concurrently. Dependencies on fillers that are not in
+ * the list are ignored. The graph is built once and executed for every event.
+ */
+class FillerGraph {
+ public:
+  //! Called with the index of the filler in the list
+  typedef std::function<void(unsigned)> Step;
+
+  FillerGraph(std::vector<FillerBase*> const&, Step const& fill, Step const& setRefs);
+
+  //! Execute all steps and wait for completion. Exceptions from the steps are rethrown.
+  void run();
+
+ private:
+  typedef tbb::flow::continue_node<tbb::flow::continue_msg> Node;
+
+  tbb::flow::graph graph_;
+  tbb::flow::broadcast_node<tbb::flow::continue_msg> start_;
+  std::vector<std::unique_ptr<Node>> fillNodes_;
+  std::vector<std::unique_ptr<Node>> refNodes_;
+};
+
+#endif
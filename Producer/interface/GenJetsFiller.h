@@ -56,6 +56,9 @@ class GenJetsFiller : public FillerBase {
 
   std::map<GenJetPtr, std::vector<reco::CandidatePtr>> jetBHadrons_;
   std::map<GenJetPtr, std::vector<reco::CandidatePtr>> jetCHadrons_;
+
+  ObjectMapHandle<reco::GenJet, suep::GenJet> genJetMap_{};
+  ObjectMapHandle<reco::Candidate, suep::GenParticle> genParticleMap_{};
 };
 
 #endif
@@ -2,6 +2,7 @@
 #define SUEPProd_Producer_GenParticlesFiller_h
 
 #include "FillerBase.h"
+#include "EventExtension.h"
 
 #include "DataFormats/HepMCCandidate/interface/GenParticle.h"
 #include "DataFormats/PatCandidates/interface/PackedGenParticle.h"
@@ -14,7 +15,7 @@ class GenParticlesFiller : public FillerBase {
   ~GenParticlesFiller() {}
 
   void branchNames(suep::utils::BranchList& eventBranches, suep::utils::BranchList&) const override;
-  void addOutput(TFile&) override;
+  void eventExtensions(std::vector<EventExtension*>&) override;
   void fill(suep::Event&, edm::Event const&, edm::EventSetup const&) override;
 
  protected:
@@ -28,8 +29,9 @@ class GenParticlesFiller : public FillerBase {
   bool fillPacked_{true};
   bool fillUnpacked_{false};
 
-  suep::UnpackedGenParticleCollection outUnpacked = suep::UnpackedGenParticleCollection("genParticlesU", 256);
-  TTree* outputTree_{0};
+  CollectionExtension<suep::UnpackedGenParticleCollection> unpacked_{"genParticlesU", 256};
+
+  ObjectMapHandle<reco::Candidate, suep::GenParticle> genParticleMap_{};
 };
 
 #endif
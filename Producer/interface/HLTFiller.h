@@ -16,6 +16,7 @@ class HLTFiller : public FillerBase {
   void branchNames(suep::utils::BranchList& eventBranches, suep::utils::BranchList&) const override;
   void fill(suep::Event&, edm::Event const&, edm::EventSetup const&) override;
   void fillBeginRun(suep::Run&, edm::Run const&, edm::EventSetup const&) override;
+  void afterRollover(suep::Run&) override;
   void notifyNewProduct(edm::BranchDescription const&, edm::ConsumesCollector&) override;
 
  protected:
@@ -41,6 +42,9 @@ class HLTFiller : public FillerBase {
   // The vector needs to be a member data of this class to ensure validity of the pointer in
   // the objectMaps.
   std::vector<VString> filterNames_;
+
+  ObjectMapHandle<pat::TriggerObjectStandAlone, suep::HLTObject> hltObjectMap_{};
+  ObjectMapHandle<pat::TriggerObjectStandAlone, VString> hltNameMap_{};
 };
 
 #endif
@@ -0,0 +1,96 @@
+#ifndef SUEPProd_Producer_JetCorrectionTables_h
+#define SUEPProd_Producer_JetCorrectionTables_h
+
+#include <vector>
+
+class JetCorrectorParameters;
+namespace JME {
+  class JetResolutionObject;
+}
+
+// Flat lookup tables compiled from the JEC uncertainty and JER payloads at IOV change.
+// The evaluate() functions work on whole arrays of jets and are const (safe to share between fillers).
+
+//! JEC uncertainty ("Uncertainty" level, binned in JetEta with a JetPt grid)
+/*!
+ * Same as JetCorrectionUncertainty: first bin with min <= eta < max, linear interpolation between
+ * the pt grid points, clamped at the ends. Jets outside all bins get -999.
+ */
+class JECUncertaintyTable {
+ public:
+  JECUncertaintyTable() {}
+  JECUncertaintyTable(JetCorrectorParameters const&);
+
+  void evaluate(unsigned n, float const* eta, float const* pt, float* up, float* down) const;
+
+ private:
+  int findBin_(float eta) const;
+
+  bool sorted_{true}; //! bins are ordered and non-overlapping -> binary search
+  std::vector<float> etaMin_{};
+  std::vector<float> etaMax_{};
+  //! grid of bin i is [gridStart_[i], gridStart_[i + 1])
+  std::vector<unsigned> gridStart_{};
+  std::vector<float> pt_{};
+  std::vector<float> up_{};
+  std::vector<float> down_{};
+};
+
+//! First record of a JetResolutionObject containing the bin values (inclusive ranges, as JetResolutionObject::getRecord)
+class JERRecordFinder {
+ public:
+  JERRecordFinder() {}
+  JERRecordFinder(JME::JetResolutionObject const&);
+
+  //! Record index or -1
+  int find(float eta, float rho) const;
+  unsigned size() const { return nRecords_; }
+
+ private:
+  unsigned nRecords_{0};
+  unsigned nBins_{0};
+  //! which of (eta, |eta|, rho) each bin variable is
+  std::vector<unsigned> binSource_{};
+  //! [iRecord * nBins_ + iBin]
+  std::vector<float> min_{};
+  std::vector<float> max_{};
+};
+
+//! Relative pt resolution, tabulated per record on a grid uniform in log(pt) over the record pt range
+/*!
+ * The payload formula is evaluated at the grid points at construction and interpolated linearly
+ * in log(pt); pt outside the range is clamped (as JetResolutionObject::evaluateFormula does).
+ * Jets without a record get 1.
+ */
+class JetResolutionTable {
+ public:
+  static unsigned const kGridSize = 256;
+
+  JetResolutionTable() {}
+  JetResolutionTable(JME::JetResolutionObject const&);
+
+  void evaluate(unsigned n, float const* eta, float const* pt, float rho, float* resolution) const;
+
+ private:
+  JERRecordFinder records_{};
+  std::vector<float> logPtMin_{};
+  std::vector<float> invStep_{};
+  //! kGridSize values per record
+  std::vector<float> values_{};
+};
+
+//! JER scale factors (nominal, up, down) binned in eta; jets without a record get 1
+class JetResolutionSFTable {
+ public:
+  JetResolutionSFTable() {}
+  JetResolutionSFTable(JME::JetResolutionObject const&);
+
+  void evaluate(unsigned n, float const* eta, float* sf, float* sfUp, float* sfDown) const;
+
+ private:
+  JERRecordFinder records_{};
+  //! [iRecord * 3 + Variation]
+  std::vector<float> values_{};
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SUEPProd_Producer_JetCorrectionsCache_h
+#define SUEPProd_Producer_JetCorrectionsCache_h
+
+#include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/ESWatcher.h"
+
+#include "CondFormats/DataRecord/interface/JetResolutionRcd.h"
+#include "CondFormats/DataRecord/interface/JetResolutionScaleFactorRcd.h"
+#include "JetMETCorrections/Objects/interface/JetCorrectionsRecord.h"
+
+#include "JetCorrectionTables.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+//! JEC uncertainty and JER lookup tables, shared by the jet fillers of one stream
+/*!
+ * Tables are compiled from the EventSetup payloads on first use and kept until the corresponding
+ * record (JetCorrectionsRecord, JetResolutionRcd, JetResolutionScaleFactorRcd) changes, which is
+ * checked with ESWatchers on every call. The tables are const and can be used concurrently.
+ * References stay valid until the end of the event. Call with the framework lock held.
+ */
+class JetCorrectionsCache {
+ public:
+  struct JER {
+    JetResolutionTable ptRes{};
+    JetResolutionSFTable ptResSF{};
+  };
+
+  JECUncertaintyTable const& getJEC(edm::EventSetup const&, std::string const& jecName);
+  //! Resolution "<jerName>_pt" and scale factor "<jerName>"
+  JER const& getJER(edm::EventSetup const&, std::string const& jerName);
+
+ private:
+  std::mutex mutex_;
+
+  edm::ESWatcher<JetCorrectionsRecord> jecWatcher_{};
+  std::map<std::string, JECUncertaintyTable> jec_{};
+
+  edm::ESWatcher<JetResolutionRcd> jerWatcher_{};
+  edm::ESWatcher<JetResolutionScaleFactorRcd> jerSFWatcher_{};
+  std::map<std::string, JER> jer_{};
+};
+
+#endif
@@ -9,9 +9,9 @@
 #include "DataFormats/JetReco/interface/GenJetCollection.h"
 #include "DataFormats/PatCandidates/interface/Jet.h"
 
-#include <functional>
+#include "SUEPProd/Utilities/interface/EtaPhiMatcher.h"
 
-class JetCorrectionUncertainty;
+#include <functional>
 
 class JetsFiller : public FillerBase {
  public:
@@ -19,6 +19,7 @@ class JetsFiller : public FillerBase {
   ~JetsFiller();
 
   void branchNames(suep::utils::BranchList& eventBranches, suep::utils::BranchList&) const override;
+  void setBookedBranches(suep::utils::BranchList const& eventBranches, suep::utils::BranchList const&) override;
   void fill(suep::Event&, edm::Event const&, edm::EventSetup const&) override;
   void setRefs(ObjectMapStore const&) override;
 
@@ -63,8 +64,6 @@ class JetsFiller : public FillerBase {
 
   std::string puidTag_;
 
-  JetCorrectionUncertainty* jecUncertainty_{0};
-
   typedef std::function<suep::JetCollection&(suep::Event&)> OutputSelector;
 
   OutputSelector outputSelector_{};
@@ -77,7 +76,21 @@ class JetsFiller : public FillerBase {
   double maxEta_{4.7};
 
   bool fillConstituents_{false};
+  bool linkSecondaryVertex_{false};
   unsigned subjetsOffset_{0}; // first N constituents are actually subjets (happens when fixDaughters = True in JetSubstructurePacker)
+
+  ObjectMapHandle<reco::Jet, suep::Jet> jetMap_{};
+  ObjectMapHandle<reco::GenJet, suep::Jet> genJetMap_{};
+  ObjectMapHandle<reco::Candidate, suep::PFCand> pfMap_{};
+  ObjectMapHandle<reco::VertexCompositePtrCandidate, suep::SecondaryVertex> svMap_{};
+  ObjectMapHandle<reco::Vertex, suep::RecoVertex> pvMap_{};
+  ObjectMapHandle<reco::GenJet, suep::GenJet> genMap_{};
+
+  //! one-to-one gen jet matching (best dR first) instead of the nearest gen jet for each jet
+  bool uniqueGenJetMatch_{false};
+  //! targets: gen jets / pileup-id jets of the current event
+  EtaPhiMatcher genJetMatcher_;
+  EtaPhiMatcher puidMatcher_;
 };
 
 #endif
@@ -0,0 +1,51 @@
+#ifndef SUEPProd_Producer_LatencyHistogram_h
+#define SUEPProd_Producer_LatencyHistogram_h
+
+#include "TH1D.h"
+
+#include <chrono>
+#include <vector>
+
+//! Distribution of execution times in logarithmic buckets
+/*!
+ * Buckets are equally spaced in log10(t) with nBinsPerDecade buckets per decade starting at 100 ns,
+ * giving a constant relative resolution of ~12% (HDR-histogram style). Times below 100 ns go to the
+ * first bucket and times above 1000 s to the last one. Quantiles are given as the upper edge of the
+ * bucket they fall in (but never above the maximum recorded time).
+ */
+class LatencyHistogram {
+ public:
+  typedef std::chrono::steady_clock::duration Duration;
+
+  static unsigned const nBinsPerDecade = 20;
+  static unsigned const nDecades = 10;
+  static unsigned const nBins = nBinsPerDecade * nDecades + 2;
+
+  LatencyHistogram() : counts_(nBins, 0) {}
+
+  void fill(Duration const&);
+  //! Add the contents of another histogram (e.g. from another stream)
+  void add(LatencyHistogram const&);
+
+  unsigned long long getCount() const { return count_; }
+  //! Mean in ms
+  double getMean() const;
+  //! Quantile in ms
+  double getQuantile(double) const;
+  //! Maximum in ms
+  double getMax() const { return maxNS_ * 1.e-6; }
+
+  //! Create a TH1D (x axis in ms, same buckets). Caller takes ownership.
+  TH1D* makeTH1(char const* name, char const* title) const;
+
+ private:
+  //! Upper edge of the bucket in ns
+  static double upperEdgeNS_(unsigned);
+
+  std::vector<unsigned long long> counts_;
+  unsigned long long count_{0};
+  double sumNS_{0.};
+  long long maxNS_{0};
+};
+
+#endif
@@ -24,6 +24,14 @@ class MuonsFiller : public FillerBase {
   NamedToken<reco::VertexCollection> verticesToken_;
 
   RoccoR rochesterCorrector_;
+
+  ObjectMapHandle<reco::Muon, suep::Muon> muMuMap_{};
+  ObjectMapHandle<reco::Candidate, suep::Muon> pfMuMap_{};
+  ObjectMapHandle<reco::Vertex, suep::Muon> vtxMuMap_{};
+  ObjectMapHandle<reco::Candidate, suep::Muon> genMuMap_{};
+  ObjectMapHandle<reco::Candidate, suep::PFCand> pfMap_{};
+  ObjectMapHandle<reco::Vertex, suep::RecoVertex> vtxMap_{};
+  ObjectMapHandle<reco::Candidate, suep::GenParticle> genMap_{};
 };
 
 #endif
@@ -5,9 +5,12 @@
 #include "SUEPTree/Framework/interface/Object.h"
 
 #include <map>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <typeinfo>
+#include <vector>
 
 //! Abstract base to handle ObjectMaps for different types in a single container
 class ObjectMapBase {
@@ -23,18 +26,65 @@ class ObjectMapBase {
 };
 
 //! Actual EDM <-> suep map
+/*!
+ * The map is stored as a list of the added pairs (links(), in the order of addition) and dense
+ * per-product vectors addressed by (ProductID, key) for the lookups from EDM (find() / at()). Both
+ * keep their capacity across events, so a filled map does not allocate once warmed up.
+ * If the same EDM object is added more than once, find() returns the first addition; links() has
+ * all of them. The ordered fwdMap() and bwdMap() are built from the links on first access in the
+ * event, for code that needs them.
+ */
 template<class EDM, class PANDA>
 class ObjectMap : public ObjectMapBase {
   typedef edm::Ptr<EDM> EDMPtr;
 
  public:
-  std::map<EDMPtr, PANDA*> fwdMap;
-  std::map<PANDA*, EDMPtr> bwdMap;
+  struct Link {
+    EDMPtr edmPtr;
+    PANDA* suepObj;
+  };
+  typedef std::vector<Link> Links;
 
-  void clear() override { fwdMap.clear(); bwdMap.clear(); }
+  void clear() override;
   MapId getId() const override { return MapId(typeid(EDM).hash_code(), typeid(PANDA).hash_code(), label); }
 
-  void add(EDMPtr const& edmRef, PANDA& suepObj) { fwdMap.emplace(edmRef, &suepObj); bwdMap.emplace(&suepObj, edmRef); }
+  void add(EDMPtr const& edmRef, PANDA& suepObj);
+  //! Returns 0 if edmRef is not mapped
+  PANDA* find(EDMPtr const& edmRef) const { return find(edmRef.id(), edmRef.key()); }
+  PANDA* find(edm::ProductID const&, size_t key) const;
+  //! Throws std::out_of_range if edmRef is not mapped
+  PANDA* at(EDMPtr const& edmRef) const;
+
+  //! All added pairs in the order of addition
+  Links const& links() const { return links_; }
+  typename Links::const_iterator begin() const { return links_.begin(); }
+  typename Links::const_iterator end() const { return links_.end(); }
+  size_t size() const { return links_.size(); }
+  //! True if this link is the first addition of its EDM object (the one find() returns)
+  bool isFirst(Link const& link) const { return find(link.edmPtr) == link.suepObj; }
+
+  //! EDM -> suep (first addition wins), built on first access in the event
+  std::map<EDMPtr, PANDA*> const& fwdMap() const;
+  //! suep -> EDM (first addition wins), built on first access in the event
+  std::map<PANDA*, EDMPtr> const& bwdMap() const;
+
+ private:
+  //! suep objects of one product, indexed by the key
+  struct ProductSlots {
+    edm::ProductID id;
+    std::vector<PANDA*> objects;
+  };
+
+  Links links_{};
+  //! usually one or two products per map - a linear search is the fastest
+  std::vector<ProductSlots> slots_{};
+
+  //! the ordered maps may be requested from setRefs of several fillers running concurrently
+  mutable std::mutex orderedMapsMutex_{};
+  mutable bool fwdMapBuilt_{false};
+  mutable bool bwdMapBuilt_{false};
+  mutable std::map<EDMPtr, PANDA*> fwdMap_{};
+  mutable std::map<PANDA*, EDMPtr> bwdMap_{};
 };
 
 //! ObjectMap for a single filler
@@ -53,6 +103,126 @@ class FillerObjectMap : public std::map<ObjectMapBase::MapId, ObjectMapBase*> {
 
 typedef std::map<std::string, FillerObjectMap> ObjectMapStore;
 
+//! Typed reference to an ObjectMap of a filler
+/*!
+ * Handles are registered in the filler constructors (FillerBase::registerObjectMap_ and
+ * consumesObjectMap_) and resolved once after all fillers are constructed. Per-event access is a
+ * pointer dereference, without the typeid / label / filler name lookups of FillerObjectMap::get.
+ */
+template<class EDM, class PANDA>
+class ObjectMapHandle {
+ public:
+  typedef ObjectMap<EDM, PANDA> Map;
+
+  Map& operator*() const { return *get(); }
+  Map* operator->() const { return get(); }
+  Map* get() const;
+  bool isValid() const { return map_ != 0; }
+
+  //! Point the handle to the map in the store. The handle stays invalid if the filler does not exist.
+  void resolve(ObjectMapStore&);
+
+  std::string fillerName{};
+  std::string label{};
+
+ private:
+  Map* map_{0};
+};
+
+template<class EDM, class PANDA>
+void
+ObjectMap<EDM, PANDA>::clear()
+{
+  // keep the allocated capacities for the next event
+  links_.clear();
+  for (auto& slots : slots_)
+    slots.objects.clear();
+
+  if (fwdMapBuilt_) {
+    fwdMap_.clear();
+    fwdMapBuilt_ = false;
+  }
+  if (bwdMapBuilt_) {
+    bwdMap_.clear();
+    bwdMapBuilt_ = false;
+  }
+}
+
+template<class EDM, class PANDA>
+void
+ObjectMap<EDM, PANDA>::add(EDMPtr const& _edmRef, PANDA& _suepObj)
+{
+  links_.push_back(Link{_edmRef, &_suepObj});
+
+  unsigned iS(0);
+  for (; iS != slots_.size(); ++iS) {
+    if (slots_[iS].id == _edmRef.id())
+      break;
+  }
+  if (iS == slots_.size()) {
+    slots_.emplace_back();
+    slots_.back().id = _edmRef.id();
+  }
+
+  auto& objects(slots_[iS].objects);
+  if (_edmRef.key() >= objects.size())
+    objects.resize(_edmRef.key() + 1, 0);
+
+  if (!objects[_edmRef.key()]) // first addition wins
+    objects[_edmRef.key()] = &_suepObj;
+}
+
+template<class EDM, class PANDA>
+PANDA*
+ObjectMap<EDM, PANDA>::find(edm::ProductID const& _id, size_t _key) const
+{
+  for (auto& slots : slots_) {
+    if (slots.id == _id)
+      return _key < slots.objects.size() ? slots.objects[_key] : 0;
+  }
+  return 0;
+}
+
+template<class EDM, class PANDA>
+PANDA*
+ObjectMap<EDM, PANDA>::at(EDMPtr const& _edmRef) const
+{
+  auto* obj(find(_edmRef));
+  if (!obj)
+    throw std::out_of_range("ObjectMap::at");
+  return obj;
+}
+
+template<class EDM, class PANDA>
+std::map<edm::Ptr<EDM>, PANDA*> const&
+ObjectMap<EDM, PANDA>::fwdMap() const
+{
+  std::lock_guard<std::mutex> lock(orderedMapsMutex_);
+
+  if (!fwdMapBuilt_) {
+    for (auto& link : links_)
+      fwdMap_.emplace(link.edmPtr, link.suepObj);
+    fwdMapBuilt_ = true;
+  }
+
+  return fwdMap_;
+}
+
+template<class EDM, class PANDA>
+std::map<PANDA*, edm::Ptr<EDM>> const&
+ObjectMap<EDM, PANDA>::bwdMap() const
+{
+  std::lock_guard<std::mutex> lock(orderedMapsMutex_);
+
+  if (!bwdMapBuilt_) {
+    for (auto& link : links_)
+      bwdMap_.emplace(link.suepObj, link.edmPtr);
+    bwdMapBuilt_ = true;
+  }
+
+  return bwdMap_;
+}
+
 template<class EDM, class PANDA>
 ObjectMap<EDM, PANDA>&
 FillerObjectMap::get(std::string label/* = ""*/)
@@ -75,4 +245,24 @@ FillerObjectMap::get(std::string label/* = ""*/) const
   return static_cast<ObjectMap<EDM, PANDA> const&>(*at(id));
 }
 
+template<class EDM, class PANDA>
+ObjectMap<EDM, PANDA>*
+ObjectMapHandle<EDM, PANDA>::get() const
+{
+  if (!map_)
+    throw std::out_of_range("ObjectMap of " + fillerName + " is not available");
+  return map_;
+}
+
+template<class EDM, class PANDA>
+void
+ObjectMapHandle<EDM, PANDA>::resolve(ObjectMapStore& _store)
+{
+  auto sItr(_store.find(fillerName));
+  if (sItr == _store.end())
+    map_ = 0;
+  else
+    map_ = &sItr->second.get<EDM, PANDA>(label);
+}
+
 #endif
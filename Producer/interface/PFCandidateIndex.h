@@ -0,0 +1,34 @@
+#ifndef SUEPProd_Producer_PFCandidateIndex_h
+#define SUEPProd_Producer_PFCandidateIndex_h
+
+#include "DataFormats/Provenance/interface/ProductID.h"
+
+#include "SUEPProd/Utilities/interface/EtaPhiGrid.h"
+
+#include "PFCandidateSnapshot.h"
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+//! Eta-phi indices over the PF candidates of the current event, shared by the fillers of one stream
+/*!
+ * The grid of a collection is built from its PFCandidateSnapshot by the first filler asking for it in
+ * the event and reused by the others; grid indices are the indices in the candidate collection. One
+ * grid is kept per collection (ProductID). get() is thread safe. SUEPProducer calls reset() after
+ * each event; the grids are reused in the next event.
+ */
+class PFCandidateIndex {
+ public:
+  EtaPhiGrid const& get(PFCandidateSnapshot const&);
+  void reset() { nUsed_ = 0; }
+
+ private:
+  std::mutex mutex_;
+  //! The first nUsed_ entries are built in the current event
+  std::vector<std::pair<edm::ProductID, std::unique_ptr<EtaPhiGrid>>> grids_{};
+  unsigned nUsed_{0};
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SUEPProd_Producer_PFCandidateSnapshot_h
+#define SUEPProd_Producer_PFCandidateSnapshot_h
+
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/PatCandidates/interface/PackedCandidate.h"
+#include "DataFormats/Provenance/interface/ProductID.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//! Single-pass digest of a PF candidate collection of the current event
+/*!
+ * One loop over the collection unpacks the kinematics into arrays indexed like the collection,
+ * resolves the PackedCandidate cast and the vertex association, and accumulates the aggregates the
+ * fillers need (momentum sums per candidate category, candidates per vertex, charged candidates).
+ * Snapshots are handed out by PFCandidateSnapshotStore.
+ */
+class PFCandidateSnapshot {
+ public:
+  //! Candidate categories for the momentum sums. kMuon, kNeutralHadron, kPhoton and kHF are exclusive; kCharged is independent.
+  enum Category {
+    kMuon,
+    kNeutralHadron, // pdgId 130
+    kPhoton,
+    kHF, // pdgId 1 and 2
+    kCharged,
+    nCategories
+  };
+
+  //! Fill from the collection, reusing the array capacities of previous events
+  void fill(edm::View<reco::Candidate> const&);
+
+  edm::ProductID const& id() const { return source_; }
+  unsigned size() const { return pdgId_.size(); }
+
+  //! Null if the candidate is not a PackedCandidate
+  pat::PackedCandidate const* packed(unsigned i) const { return packed_[i]; }
+  int pdgId(unsigned i) const { return pdgId_[i]; }
+  int charge(unsigned i) const { return charge_[i]; }
+  float pt(unsigned i) const { return pt_[i]; }
+  float eta(unsigned i) const { return eta_[i]; }
+  float phi(unsigned i) const { return phi_[i]; }
+  //! Key of the associated vertex (PackedCandidate::vertexRef), -1 if none
+  int vertexKey(unsigned i) const { return vertexKey_[i]; }
+
+  //! Sum of px (py) over the candidates in the category
+  double sumPx(Category c) const { return sumPx_[c]; }
+  double sumPy(Category c) const { return sumPy_[c]; }
+  //! Number of candidates associated to the vertex with the given key
+  unsigned nCandidates(unsigned vertexKey) const { return vertexKey < nPerVertex_.size() ? nPerVertex_[vertexKey] : 0; }
+  //! Indices of the charged candidates
+  std::vector<unsigned> const& charged() const { return charged_; }
+
+ private:
+  edm::ProductID source_{};
+
+  std::vector<pat::PackedCandidate const*> packed_{};
+  std::vector<int> pdgId_{};
+  std::vector<signed char> charge_{};
+  std::vector<float> pt_{};
+  std::vector<float> eta_{};
+  std::vector<float> phi_{};
+  std::vector<int> vertexKey_{};
+
+  double sumPx_[nCategories]{};
+  double sumPy_[nCategories]{};
+  std::vector<unsigned> nPerVertex_{};
+  std::vector<unsigned> charged_{};
+};
+
+//! PFCandidateSnapshots of the current event, shared by the fillers of one stream
+/*!
+ * Holds one snapshot per candidate collection (ProductID) requested in the event, so fillers may
+ * read different collections. The first filler calling get() for a collection fills its snapshot;
+ * get() is thread safe. SUEPProducer calls reset() after each event; the snapshot objects and their
+ * arrays are reused in the next event.
+ */
+class PFCandidateSnapshotStore {
+ public:
+  PFCandidateSnapshot const& get(edm::View<reco::Candidate> const&);
+  void reset() { nUsed_ = 0; }
+
+ private:
+  std::mutex mutex_;
+  //! The first nUsed_ entries are filled in the current event
+  std::vector<std::unique_ptr<PFCandidateSnapshot>> snapshots_{};
+  unsigned nUsed_{0};
+};
+
+#endif
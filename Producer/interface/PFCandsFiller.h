@@ -7,12 +7,26 @@
 #include "DataFormats/VertexReco/interface/VertexFwd.h"
 #include "DataFormats/Common/interface/ValueMap.h"
 
+#include <map>
+
+//! Fills pfCandidates and tracks
+/*!
+ * With thinning = True, only candidates passing
+ *  . pt > minPt (per |pdgId| through minPtByPdgId = ["pdgId:minPt", ...], defaultMinPt otherwise)
+ *  . puppi weight >= minPuppiWeight
+ *  . for charged candidates, fromPV() >= minChargedFromPV
+ * are written, plus all candidates referenced (as daughters or source candidates, following
+ * sourceCandidatePtr chains) by the collections in keepReferencedBy. References from other
+ * branches go through the ObjectMap and thus point to the thinned indices; references to dropped
+ * candidates are left empty.
+ */
 class PFCandsFiller : public FillerBase {
  public:
   PFCandsFiller(std::string const&, edm::ParameterSet const&, edm::ConsumesCollector&);
   ~PFCandsFiller() {}
 
   void branchNames(suep::utils::BranchList& eventBranches, suep::utils::BranchList&) const override;
+  void setBookedBranches(suep::utils::BranchList const& eventBranches, suep::utils::BranchList const&) override;
   void fill(suep::Event&, edm::Event const&, edm::EventSetup const&) override;
   void setRefs(ObjectMapStore const&) override;
 
@@ -29,10 +43,22 @@ class PFCandsFiller : public FillerBase {
   NamedToken<VertexView> verticesToken_;
 
   bool useExistingWeights_{true};
+  bool fillTracks_{true};
+
+  bool thinning_{false};
+  double defaultMinPt_{0.};
+  std::map<int, double> minPtByPdgId_{};
+  double minPuppiWeight_{-1.};
+  int minChargedFromPV_{0};
+  std::vector<NamedToken<reco::CandidateView>> keepReferencedByTokens_{};
 
-  //! cache the candidate and vertex ordering (using ref keys) to use in setRefs
-  suep::PFCandCollection* outCandidates_{};
+  //! cache the vertex ordering (using ref keys) and the candidate range ends to use in setRefs
   std::vector<VertexPtr> orderedVertices_{};
+  std::vector<unsigned> pfRangeMax_{};
+
+  ObjectMapHandle<reco::Candidate, suep::PFCand> pfMap_{};
+  ObjectMapHandle<reco::Candidate, suep::PFCand> puppiMap_{};
+  ObjectMapHandle<reco::Vertex, suep::RecoVertex> vtxMap_{};
 };
 
 #endif
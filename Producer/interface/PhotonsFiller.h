@@ -52,6 +52,14 @@ class PhotonsFiller : public FillerBase {
   TFormula chIsoLeakage_[2];
   TFormula nhIsoLeakage_[2];
   TFormula phIsoLeakage_[2];
+
+  ObjectMapHandle<reco::Photon, suep::Photon> phoPhoMap_{};
+  ObjectMapHandle<reco::SuperCluster, suep::Photon> scPhoMap_{};
+  ObjectMapHandle<reco::Candidate, suep::Photon> pfPhoMap_{};
+  ObjectMapHandle<reco::Candidate, suep::Photon> genPhoMap_{};
+  ObjectMapHandle<reco::SuperCluster, suep::SuperCluster> scMap_{};
+  ObjectMapHandle<reco::Candidate, suep::PFCand> pfMap_{};
+  ObjectMapHandle<reco::Candidate, suep::GenParticle> genMap_{};
 };
 
 #endif
@@ -18,6 +18,10 @@ class SecondaryVerticesFiller : public FillerBase {
   typedef edm::View<reco::VertexCompositePtrCandidate> SecondaryVertexView;
   NamedToken<SecondaryVertexView> secondaryVerticesToken_;
 
+
+  ObjectMapHandle<reco::VertexCompositePtrCandidate, suep::SecondaryVertex> svMap_{};
+  ObjectMapHandle<reco::Candidate, suep::PFCand> pfCandMap_{};
+  ObjectMapHandle<reco::Vertex, suep::RecoVertex> pvMap_{};
 };
 
 #endif
@@ -22,6 +22,8 @@ class SuperClustersFiller : public FillerBase {
   NamedToken<SuperClusterView> superClustersToken_;
   NamedToken<EcalRecHitCollection> ebHitsToken_;
   NamedToken<EcalRecHitCollection> eeHitsToken_;
+
+  ObjectMapHandle<reco::SuperCluster, suep::SuperCluster> scMap_{};
 };
 
 #endif
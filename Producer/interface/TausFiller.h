@@ -22,6 +22,12 @@ class TausFiller : public FillerBase {
 
   NamedToken<TauView> tausToken_;
   NamedToken<GenParticleView> genParticlesToken_;
+
+  ObjectMapHandle<reco::BaseTau, suep::Tau> tauMap_{};
+  ObjectMapHandle<reco::Vertex, suep::Tau> vtxTauMap_{};
+  ObjectMapHandle<reco::Candidate, suep::Tau> genTauMap_{};
+  ObjectMapHandle<reco::Vertex, suep::RecoVertex> vtxMap_{};
+  ObjectMapHandle<reco::Candidate, suep::GenParticle> genMap_{};
 };
 
 #endif
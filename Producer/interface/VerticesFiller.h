@@ -39,6 +39,8 @@ class VerticesFiller : public FillerBase {
   //! fillAll and fill will collect identical information -> cache it in fillAll
   unsigned short npvCache_{0};
   unsigned short npvTrueCache_{0};
+
+  ObjectMapHandle<reco::Vertex, suep::RecoVertex> vtxMap_{};
 };
 
 #endif
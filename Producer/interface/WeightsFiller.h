@@ -22,26 +22,34 @@ class WeightsFiller : public FillerBase {
   WeightsFiller(std::string const&, edm::ParameterSet const&, edm::ConsumesCollector&);
   ~WeightsFiller() {}
 
+  void setEventWriters(std::vector<EventWriter*> const&) override;
   void branchNames(suep::utils::BranchList&, suep::utils::BranchList&) const override;
   void addOutput(TFile&) override;
   void fillAll(edm::Event const&, edm::EventSetup const&) override;
   void fill(suep::Event&, edm::Event const&, edm::EventSetup const&) override;
   void fillEndRun(suep::Run&, edm::Run const&, edm::EventSetup const&) override;
+  void beforeRollover(suep::Run&) override;
   void notifyNewProduct(edm::BranchDescription const&, edm::ConsumesCollector&) override;
 
  protected:
   void getLHEWeights_(LHEEventProduct const&);
-  void bookGenParam_();
+  //! Pass the learned signal weight ids to the writers, which book the genParam branch
+  void setGenParamIds_();
+  //! Leave the learning phase before it is complete (at run boundaries and output rollovers)
+  void endLearningPhase_();
 
   NamedToken<GenEventInfoProduct> genInfoToken_;
   NamedToken<LHEEventProduct> lheEventToken_;
 
-  // learn the size of the signal weights vector in the first 100 events
+  // learn the size of the signal weights vector in the first 100 events of the stream
   static unsigned const learningPhase{100};
   
+  //! Save signal weights to genReweight.genParam
+  bool const saveGenParam_;
   std::vector<TString> wids_{};
-  float genParamBuffer_[learningPhase][suep::GenReweight::NMAX]{};
-  unsigned bufferCounter_{0};
+  //! Events seen in the learning phase; 0xffffffff once the ids are passed to the writers
+  unsigned learningCounter_{0};
+  std::vector<EventWriter*> writers_{};
 
   unsigned pdfBegin_{0};
   unsigned pdfEnd_{0};
@@ -53,9 +61,6 @@ class WeightsFiller : public FillerBase {
 
   // these objects will be deleted automatically when the output file closes
   TH1D* hSumW_{0};
-
-  // need to hold on to the output file handle
-  TFile* outputFile_{0};
 };
 
 #endif
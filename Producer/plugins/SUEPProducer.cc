@@ -1,22 +1,36 @@
-#include "FWCore/Framework/interface/one/EDAnalyzer.h"
+#include "FWCore/Framework/interface/stream/EDAnalyzer.h"
 #include "FWCore/Framework/interface/Run.h"
 #include "FWCore/Framework/interface/LuminosityBlock.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 #include "FWCore/Utilities/interface/InputTag.h"
+#include "FWCore/Utilities/interface/StreamID.h"
+#include "FWCore/Utilities/interface/EDMException.h"
 #include "FWCore/Common/interface/TriggerNames.h"
 #include "DataFormats/Common/interface/TriggerResults.h"
 #include "DataFormats/Common/interface/Handle.h"
+#include "DataFormats/Provenance/interface/ModuleDescription.h"
 
 #include "SUEPTree/Objects/interface/Event.h"
 
 #include "../interface/FillerBase.h"
 #include "../interface/ObjectMap.h"
+#include "../interface/EventWriter.h"
+#include "../interface/FillerGraph.h"
+#include "../interface/LatencyHistogram.h"
+#include "../interface/AllocationCounter.h"
+#include "../interface/JetCorrectionsCache.h"
 
 #include "TFile.h"
+#include "TMemFile.h"
+#include "TH1.h"
 #include "TTree.h"
-#include "TH1D.h"
 #include <vector>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <utility>
 #include <chrono>
 
@@ -26,56 +40,153 @@ double toMS(SClock::duration const& interval)
   return std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count() * 1.e-6;
 }
 
-class SUEPProducer : public edm::one::EDAnalyzer<edm::one::SharedResources, edm::one::WatchRuns, edm::one::WatchLuminosityBlocks> {
+//! Job-wide state shared by the stream instances of SUEPProducer
+/*!
+ * CMSSW hands the global cache out as a const pointer; the writers serialize themselves internally.
+ */
+struct SUEPProducerGlobal {
+  //! One writer per output. The first (primary) output also holds the filler outputs and the timing information.
+  std::vector<std::unique_ptr<EventWriter>> writers;
+};
+
+//! Number of events in a luminosity block, summed over streams
+struct SUEPLumiSummary {
+  unsigned nEvents{0};
+};
+
+//! Main ntuplizer module
+/*!
+ * One instance is created per CMSSW stream. Each instance owns its fillers, ObjectMapStore and
+ * suep::Event, so streams fill events concurrently. Filled events are handed to the EventWriter
+ * (global cache), which writes them out serially.
+ * Output objects created by the fillers (addOutput) go to the output file for stream 0 and to a
+ * scratch in-memory file for the other streams; histograms in the scratch files are added to the
+ * output at endStream.
+ * With concurrentFillers = True, fill() and setRefs() of the fillers within one event are run as a
+ * TBB task graph following the dependencies the fillers declare (see FillerGraph).
+ * Several outputs can be defined in the outputs VPSet, each with its own outputFile, SelectEvents
+ * and dropBranches (parameters not given in the output PSet are taken from the module). The fillers
+ * run once per event if any of the outputs selects it, and the event is written to the selecting
+ * outputs. The filler outputs (hlt tree, histograms) are copied from the primary (first) output to
+ * the others at the end of the job; output rollover is therefore not available with several outputs.
+ */
+class SUEPProducer : public edm::stream::EDAnalyzer<edm::GlobalCache<SUEPProducerGlobal>, edm::LuminosityBlockSummaryCache<SUEPLumiSummary>> {
 public:
-  explicit SUEPProducer(edm::ParameterSet const&);
+  explicit SUEPProducer(edm::ParameterSet const&, SUEPProducerGlobal const*);
   ~SUEPProducer();
 
+  static std::unique_ptr<SUEPProducerGlobal> initializeGlobalCache(edm::ParameterSet const&);
+  static void globalBeginJob(SUEPProducerGlobal*);
+  static void globalEndJob(SUEPProducerGlobal*);
+  static std::shared_ptr<SUEPLumiSummary> globalBeginLuminosityBlockSummary(edm::LuminosityBlock const&, edm::EventSetup const&, LuminosityBlockContext const*);
+  static void globalEndLuminosityBlockSummary(edm::LuminosityBlock const&, edm::EventSetup const&, LuminosityBlockContext const*, SUEPLumiSummary*);
+
 private:
+  void beginStream(edm::StreamID) override;
+  void endStream() override;
   void analyze(edm::Event const&, edm::EventSetup const&) override;
   void beginRun(edm::Run const&, edm::EventSetup const&) override;
   void endRun(edm::Run const&, edm::EventSetup const&) override;
   void beginLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup const&) override;
-  void endLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup const&) override;
-  void beginJob() override;
-  void endJob() override;
+  void endLuminosityBlockSummary(edm::LuminosityBlock const&, edm::EventSetup const&, SUEPLumiSummary*) const override;
+
+  enum Phase {
+    kFillAll,
+    kFill,
+    kSetRefs,
+    nPhases
+  };
+
+  //! Writer parameters of each output: the outputs VPSet entries on top of the module parameters, or the module parameters alone
+  static std::vector<edm::ParameterSet> outputConfigs_(edm::ParameterSet const&);
+
+  //! The primary writer
+  EventWriter& writer_() const { return *globalCache()->writers[0]; }
+  std::vector<std::unique_ptr<EventWriter>> const& writers_() const { return globalCache()->writers; }
+  //! True if one of the paths accepted the event (or if there are no paths)
+  bool passesSelection_(edm::Event const&, VString const& paths) const;
+  //! Call addOutput() of the fillers and bind the hlt tree to outEvent_.run
+  void addOutput_(TFile&);
+  //! Call fill() of one filler on the current event
+  void fillStep_(unsigned);
+  //! Call setRefs() of one filler
+  void setRefsStep_(unsigned);
+  //! Counts to attribute the allocations of a filler step to (null if not counting)
+  AllocationCounter::Counts* allocationCounts_(unsigned iF, Phase phase) { return countAllocations_ ? &allocations_[iF * nPhases + phase] : 0; }
+  //! Throw if the step allocated although the warm-up (zeroAllocationWarmup events) is over
+  void checkAllocations_(unsigned iF, Phase, unsigned long long nBefore) const;
 
   std::vector<FillerBase*> fillers_;
+  //! Indices of the fillers with booked output (fillAll is called for all fillers)
+  std::vector<unsigned> activeFillers_{};
   ObjectMapStore objectMaps_;
-
-  VString const selectEvents_;
+  PFCandidateSnapshotStore pfCandidateSnapshot_;
+  PFCandidateIndex pfCandidateIndex_;
+  JetCorrectionsCache jetCorrectionsCache_;
+
+  //! Set when fillers run concurrently (concurrentFillers = True)
+  std::unique_ptr<FillerGraph> fillerGraph_{};
+  std::mutex frameworkMutex_;
+  edm::Event const* inEvent_{0};
+  edm::EventSetup const* inSetup_{0};
+
+  //! Event selection and branch removal of one output
+  struct OutputSelection {
+    VString selectEvents;
+    //! Branches removed from the output on top of what the fillers veto
+    VString dropBranches;
+  };
+
+  //! One per writer
+  std::vector<OutputSelection> outputs_{};
+  std::vector<bool> selected_{};
   edm::EDGetTokenT<edm::TriggerResults> const skimResultsToken_;
 
-  TFile* outputFile_{0};
-  TTree* eventTree_{0};
-  TTree* runTree_{0};
-  TTree* lumiSummaryTree_{0};
-  TH1D* eventCounter_{0};
+  //! Holds the addOutput objects of streams other than 0
+  std::unique_ptr<TFile> scratchFile_{};
   suep::Event outEvent_;
 
   unsigned nEventsInLumi_;
 
-  std::string const outputName_;
   bool const useTrigger_;
+  bool const concurrentFillers_;
   unsigned const printLevel_;
+  bool const recordTiming_;
+  bool const timed_; //! printLevel >= 1 or recordTiming
+  unsigned const zeroAllocationWarmup_;
+  bool const countAllocations_; //! countAllocations or zeroAllocationWarmup > 0
 
   std::vector<SClock::duration> timers_;
+  std::vector<LatencyHistogram> latencies_; //! [iF * nPhases + phase]; last entry is the CMSSW time outside this module
+  std::vector<AllocationCounter::Counts> allocations_; //! [iF * nPhases + phase]
   SClock::time_point lastAnalyze_; //! Time point of last return from analyze()
   unsigned long long nEvents_;
 };
 
-SUEPProducer::SUEPProducer(edm::ParameterSet const& _cfg) :
-  selectEvents_(_cfg.getUntrackedParameter<VString>("SelectEvents")),
+SUEPProducer::SUEPProducer(edm::ParameterSet const& _cfg, SUEPProducerGlobal const*) :
   skimResultsToken_(consumes<edm::TriggerResults>(edm::InputTag("TriggerResults"))), // no process name -> pick up the trigger results from the current process
   outEvent_(),
   nEventsInLumi_(0),
-  outputName_(_cfg.getUntrackedParameter<std::string>("outputFile", "suep.root")),
   useTrigger_(_cfg.getUntrackedParameter<bool>("useTrigger", true)),
+  concurrentFillers_(_cfg.getUntrackedParameter<bool>("concurrentFillers", false)),
   printLevel_(_cfg.getUntrackedParameter<unsigned>("printLevel", 0)),
+  recordTiming_(_cfg.getUntrackedParameter<bool>("recordTiming", false)),
+  timed_(printLevel_ >= 1 || recordTiming_),
+  zeroAllocationWarmup_(_cfg.getUntrackedParameter<unsigned>("zeroAllocationWarmup", 0)),
+  countAllocations_(_cfg.getUntrackedParameter<bool>("countAllocations", false) || zeroAllocationWarmup_ != 0),
   timers_(),
+  latencies_(),
+  allocations_(),
   lastAnalyze_(),
   nEvents_(0)
 {
+  for (auto& outputCfg : outputConfigs_(_cfg)) {
+    outputs_.emplace_back();
+    outputs_.back().selectEvents = outputCfg.getUntrackedParameter<VString>("SelectEvents", VString());
+    outputs_.back().dropBranches = outputCfg.getUntrackedParameter<VString>("dropBranches", VString());
+  }
+  selected_.resize(outputs_.size(), false);
+
   auto&& coll(consumesCollector());
 
   auto& fillersCfg(_cfg.getUntrackedParameterSet("fillers"));
@@ -94,7 +205,7 @@ SUEPProducer::SUEPProducer(edm::ParameterSet const& _cfg) :
       auto className(fillerPSet.getUntrackedParameter<std::string>("filler") + "Filler");
 
       if (printLevel_ >= 1) {
-        std::cout << "[SUEPProducer::SUEPProducer] " 
+        std::cout << "[SUEPProducer::SUEPProducer] "
           << "Constructing " << className << "::" << fillerName << std::endl;
 
         if (printLevel_ >= 3)
@@ -109,24 +220,47 @@ SUEPProducer::SUEPProducer(edm::ParameterSet const& _cfg) :
 
       filler->setObjectMap(objectMaps_[fillerName]);
 
-      if (printLevel_ >= 1) {
+      if (timed_) {
         timers_.push_back(SClock::duration::zero());
+        latencies_.resize(latencies_.size() + nPhases);
 
         if (printLevel_ >= 3)
           std::cout << "Initializing " << fillerName << " took " << toMS(SClock::now() - start) << " ms." << std::endl;
       }
     }
     catch (std::exception& ex) {
-      std::cerr << "[SUEPProducer::SUEPProducer] " 
+      std::cerr << "[SUEPProducer::SUEPProducer] "
         << "Configuration error in " << fillerName << ":"
                                      << ex.what() << std::endl;
       throw;
     }
   }
 
-  if (printLevel_ >= 1) {
+  if (countAllocations_) {
+    if (!AllocationCounter::isActive())
+      throw edm::Exception(edm::errors::Configuration, "Allocation counting requires the replacement operator new; run with LD_PRELOAD=libSUEPProdProducer.so");
+
+    allocations_.resize(fillers_.size() * nPhases);
+  }
+
+  // all fillers (and their entries in objectMaps_) exist now
+  for (auto* filler : fillers_)
+    filler->resolveObjectMaps(objectMaps_);
+
+  if (timed_) {
     // timer for the CMSSW execution outside of this module
     timers_.push_back(SClock::duration::zero());
+    latencies_.emplace_back();
+  }
+
+  for (auto* filler : fillers_) {
+    filler->setPFCandidateCache(&pfCandidateSnapshot_, &pfCandidateIndex_);
+    filler->setJetCorrectionsCache(&jetCorrectionsCache_);
+  }
+
+  if (concurrentFillers_) {
+    for (auto* filler : fillers_)
+      filler->setFrameworkMutex(&frameworkMutex_);
   }
 
   // The lambda function inside will be called by CMSSW Framework whenever a new product is registered
@@ -135,10 +269,6 @@ SUEPProducer::SUEPProducer(edm::ParameterSet const& _cfg) :
       for (auto* filler : this->fillers_)
         filler->notifyNewProduct(branchDescription, coll);
     });
-
-  // Might use some thread-unsafe resource and therefore cannot run concurrently with another edm::one module
-  // This is being super-conservative - can do better by collecting information from the individual fillers.
-  usesResource();
 }
 
 SUEPProducer::~SUEPProducer()
@@ -147,12 +277,278 @@ SUEPProducer::~SUEPProducer()
     delete filler;
 }
 
+/*static*/
+std::unique_ptr<SUEPProducerGlobal>
+SUEPProducer::initializeGlobalCache(edm::ParameterSet const& _cfg)
+{
+  std::unique_ptr<SUEPProducerGlobal> global(new SUEPProducerGlobal);
+
+  auto outputConfigs(outputConfigs_(_cfg));
+
+  for (auto& outputCfg : outputConfigs) {
+    // the filler outputs of the primary file are copied to the others at the end of the job
+    if (outputConfigs.size() > 1 && (outputCfg.getUntrackedParameter<unsigned>("maxEventsPerFile", 0) != 0 || outputCfg.getUntrackedParameter<unsigned>("maxFileSize", 0) != 0))
+      throw edm::Exception(edm::errors::Configuration, "Output rollover (maxEventsPerFile, maxFileSize) is not supported with multiple outputs");
+
+    global->writers.emplace_back(new EventWriter(outputCfg));
+  }
+
+  return global;
+}
+
+/*static*/
+std::vector<edm::ParameterSet>
+SUEPProducer::outputConfigs_(edm::ParameterSet const& _cfg)
+{
+  std::vector<edm::ParameterSet> configs;
+
+  for (auto& outputPSet : _cfg.getUntrackedParameter<std::vector<edm::ParameterSet>>("outputs", std::vector<edm::ParameterSet>())) {
+    configs.push_back(_cfg);
+    for (auto& name : outputPSet.getParameterNames())
+      configs.back().copyFrom(outputPSet, name);
+  }
+
+  if (configs.empty())
+    configs.push_back(_cfg);
+
+  return configs;
+}
+
+/*static*/
+void
+SUEPProducer::globalBeginJob(SUEPProducerGlobal* _global)
+{
+  for (auto& writer : _global->writers)
+    writer->open();
+}
+
+/*static*/
+void
+SUEPProducer::globalEndJob(SUEPProducerGlobal* _global)
+{
+  auto& primary(*_global->writers[0]);
+
+  for (unsigned iW(1); iW < _global->writers.size(); ++iW) {
+    _global->writers[iW]->copyAuxiliaryObjects(primary);
+    _global->writers[iW]->close();
+  }
+
+  primary.close();
+}
+
+void
+SUEPProducer::beginStream(edm::StreamID _streamId)
+{
+  auto& writer(writer_());
+
+  if (writer.rollsOver()) {
+    // the rollover happens at the global end of a lumi; no stream may be in the next lumi by then
+    // (the process options are not available in the constructor)
+    auto& processPSet(edm::getProcessParameterSetContainingModule(moduleDescription()));
+    auto& options(processPSet.getUntrackedParameterSet("options", edm::ParameterSet()));
+    if (options.getUntrackedParameter<unsigned>("numberOfConcurrentLuminosityBlocks", 1) != 1)
+      throw edm::Exception(edm::errors::Configuration, "Output rollover (maxEventsPerFile, maxFileSize) requires process.options.numberOfConcurrentLuminosityBlocks = 1");
+  }
+
+  suep::utils::BranchList eventBranches = {"runNumber", "lumiNumber", "eventNumber", "isData"};
+  suep::utils::BranchList runBranches = {"runNumber"};
+  std::vector<EventExtension*> extensions;
+  std::vector<EventWriter*> writers;
+  for (auto& writer : writers_())
+    writers.push_back(writer.get());
+
+  for (auto* filler : fillers_) {
+    filler->branchNames(eventBranches, runBranches);
+    filler->eventExtensions(extensions);
+    filler->setEventWriters(writers);
+  }
+
+  for (unsigned iO(0); iO != outputs_.size(); ++iO) {
+    auto outputBranches(eventBranches);
+    for (auto& name : outputs_[iO].dropBranches)
+      outputBranches.emplace_back("!" + name);
+
+    writers_()[iO]->book(outEvent_, extensions, outputBranches, runBranches);
+  }
+
+  // fillers need to produce what is booked in any of the outputs: drop only what all outputs drop
+  for (auto& name : outputs_[0].dropBranches) {
+    bool droppedEverywhere(true);
+    for (auto& output : outputs_) {
+      if (std::find(output.dropBranches.begin(), output.dropBranches.end(), name) == output.dropBranches.end())
+        droppedEverywhere = false;
+    }
+    if (droppedEverywhere)
+      eventBranches.emplace_back("!" + name);
+  }
+
+  // The branch list is final. Tell the fillers what is booked and find the fillers with nothing to write.
+  std::vector<bool> active(fillers_.size(), false);
+  std::map<std::string, unsigned> indices;
+  std::vector<std::pair<std::string, suep::utils::BranchList>> branchOwners;
+  for (unsigned iF(0); iF != fillers_.size(); ++iF) {
+    auto* filler(fillers_[iF]);
+
+    filler->setBookedBranches(eventBranches, runBranches);
+
+    suep::utils::BranchList fillerBranches;
+    suep::utils::BranchList fillerRunBranches;
+    filler->branchNames(fillerBranches, fillerRunBranches);
+
+    // fillers that do not declare event branches (e.g. trigger, MET filters) are always run, and so are fillers with extensions
+    std::vector<EventExtension*> fillerExtensions;
+    filler->eventExtensions(fillerExtensions);
+    bool declared(false);
+    for (auto& bname : fillerBranches) {
+      if (bname.isVeto())
+        continue;
+
+      declared = true;
+      if (bname.in(eventBranches)) {
+        active[iF] = true;
+        break;
+      }
+    }
+    if (!declared || !fillerExtensions.empty())
+      active[iF] = true;
+
+    indices[filler->getName()] = iF;
+    branchOwners.emplace_back(filler->getName(), fillerBranches);
+  }
+
+  for (auto& writer : writers_())
+    writer->setBranchOwners(branchOwners);
+
+  // keep the fillers whose ObjectMaps are needed in setRefs of the active ones
+  bool changed(true);
+  while (changed) {
+    changed = false;
+    for (unsigned iF(0); iF != fillers_.size(); ++iF) {
+      if (!active[iF])
+        continue;
+
+      for (auto& name : fillers_[iF]->getRefDependencies()) {
+        auto itr(indices.find(name));
+        if (itr != indices.end() && !active[itr->second]) {
+          active[itr->second] = true;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  activeFillers_.clear();
+  for (unsigned iF(0); iF != fillers_.size(); ++iF) {
+    if (active[iF])
+      activeFillers_.push_back(iF);
+    else if (printLevel_ >= 1)
+      std::cout << "[SUEPProducer::beginStream] "
+                << "No booked output from " << fillers_[iF]->getName() << "; fill() and setRefs() will not be called" << std::endl;
+  }
+
+  if (concurrentFillers_) {
+    std::vector<FillerBase*> fillers;
+    for (unsigned iF : activeFillers_)
+      fillers.push_back(fillers_[iF]);
+
+    fillerGraph_.reset(new FillerGraph(fillers,
+                                       [this](unsigned iA) { this->fillStep_(this->activeFillers_[iA]); },
+                                       [this](unsigned iA) { this->setRefsStep_(this->activeFillers_[iA]); }));
+  }
+
+  // output rollover (called by the writer with its mutex locked, between luminosity blocks)
+  if (_streamId.value() == 0) {
+    writer.addRolloverClient([this](TFile&) {
+        for (auto* filler : this->fillers_)
+          filler->beforeRollover(this->outEvent_.run);
+      },
+      [this](TFile& _newFile) {
+        this->addOutput_(_newFile);
+        for (auto* filler : this->fillers_)
+          filler->afterRollover(this->outEvent_.run);
+      });
+  }
+  else {
+    writer.addRolloverClient([this](TFile& _closingFile) {
+        for (auto* filler : this->fillers_)
+          filler->beforeRollover(this->outEvent_.run);
+        // the histograms of this stream so far belong to the closing file
+        for (auto* obj : *this->scratchFile_->GetList()) {
+          auto* source(dynamic_cast<TH1*>(obj));
+          auto* target(source ? dynamic_cast<TH1*>(_closingFile.Get(source->GetName())) : 0);
+          if (target) {
+            EventWriter::addHistogram(*target, *source);
+            source->Reset();
+          }
+        }
+      },
+      [](TFile&) {});
+  }
+
+  std::lock_guard<std::mutex> lock(writer.getMutex());
+
+  if (_streamId.value() == 0)
+    addOutput_(*writer.getOutputFile());
+  else {
+    scratchFile_.reset(new TMemFile(TString::Format("suepStream%u.root", _streamId.value()), "recreate"));
+    addOutput_(*scratchFile_);
+  }
+}
+
+void
+SUEPProducer::addOutput_(TFile& _outputFile)
+{
+  for (auto* filler : fillers_)
+    filler->addOutput(_outputFile);
+
+  if (useTrigger_ && _outputFile.Get("hlt")) {
+    if (!outEvent_.run.hlt.menu)
+      outEvent_.run.hlt.create();
+    auto& hltTree(*static_cast<TTree*>(_outputFile.Get("hlt")));
+    hltTree.Branch("menu", "TString", &outEvent_.run.hlt.menu);
+    hltTree.Branch("paths", "std::vector<TString>", &outEvent_.run.hlt.paths, 32000, 0);
+    hltTree.Branch("filters", "std::vector<TString>", &outEvent_.run.hlt.filters, 32000, 0);
+  }
+}
+
+void
+SUEPProducer::endStream()
+{
+  auto& writer(writer_());
+
+  if (scratchFile_) {
+    writer.mergeStreamOutput(*scratchFile_);
+    scratchFile_->Close();
+    scratchFile_.reset();
+  }
+
+  std::vector<std::string> names;
+  std::vector<std::pair<std::string, std::string>> labels;
+  for (auto* filler : fillers_) {
+    names.push_back(filler->getName());
+    labels.emplace_back(filler->getName(), "fillAll");
+    labels.emplace_back(filler->getName(), "fill");
+    labels.emplace_back(filler->getName(), "setRefs");
+  }
+
+  if (countAllocations_)
+    writer.addAllocations(labels, allocations_);
+
+  if (timed_) {
+    labels.emplace_back("CMSSW", "other");
+
+    writer.addTimers(names, timers_, nEvents_);
+    writer.addLatencies(labels, latencies_);
+  }
+}
+
 void
 SUEPProducer::analyze(edm::Event const& _event, edm::EventSetup const& _setup)
 {
-  eventCounter_->Fill(0.5);
-  
-  if (printLevel_ >= 1) {
+  for (auto& writer : writers_())
+    writer->countEvent(false);
+
+  if (timed_) {
     if (nEvents_ == 0) {
       if (printLevel_ >= 3)
         std::cout << "[SUEPProducer::analyze] "
@@ -166,6 +562,7 @@ SUEPProducer::analyze(edm::Event const& _event, edm::EventSetup const& _setup)
                   << "Previous (CMSSW) step took " << toMS(dt) << " ms" << std::endl;
 
       timers_.back() += dt;
+      latencies_.back().fill(dt);
     }
   }
 
@@ -178,51 +575,59 @@ SUEPProducer::analyze(edm::Event const& _event, edm::EventSetup const& _setup)
   for (unsigned iF(0); iF != fillers_.size(); ++iF) {
     auto* filler(fillers_[iF]);
     try {
-      if (printLevel_ >= 1) {
+      if (timed_) {
         start = SClock::now();
 
         if (printLevel_ >= 2)
-          std::cout << "[SUEPProducer::analyze] " 
+          std::cout << "[SUEPProducer::analyze] "
                     << "Calling " << filler->getName() << "->fillAll()" << std::endl;
       }
 
-      filler->fillAll(_event, _setup);
+      {
+        auto* counts(allocationCounts_(iF, kFillAll));
+        unsigned long long nBefore(counts ? counts->nAllocations : 0);
+        AllocationCounter::Scope allocationScope(counts);
 
-      if (printLevel_ >= 1) {
+        filler->fillAll(_event, _setup);
+
+        checkAllocations_(iF, kFillAll, nBefore);
+      }
+
+      if (timed_) {
         auto dt(SClock::now() - start);
 
         if (printLevel_ >= 3) {
-          std::cout << "[SUEPProducer::analyze] " 
+          std::cout << "[SUEPProducer::analyze] "
                     << "Step " << filler->getName() << "->fillAll() took " << toMS(dt) << " ms" << std::endl;
         }
-        
+
         timers_[iF] += dt;
+        latencies_[iF * nPhases + kFillAll].fill(dt);
       }
     }
     catch (std::exception& ex) {
-      std::cerr << "[SUEPProducer::analyze] " 
+      std::cerr << "[SUEPProducer::analyze] "
         << "Error in " << filler->getName() << "::fillAll()" << std::endl;
       throw;
     }
   }
 
-  // If path names are given, check if at least one succeeded
-  if (selectEvents_.size() != 0) {
-    edm::Handle<edm::TriggerResults> triggerResults;
-    if(_event.getByToken(skimResultsToken_, triggerResults)){
-      auto& pathNames(_event.triggerNames(*triggerResults));
-      unsigned iS(0);
-      for (; iS != selectEvents_.size(); ++iS) {
-        unsigned iP(pathNames.triggerIndex(selectEvents_[iS]));
-        if (iP != pathNames.size() && triggerResults->accept(iP))
-          break;
-      }
-      if (iS == selectEvents_.size())
-        return;
-    }
+  // Check which outputs take the event; fill only if there is at least one
+  bool anySelected(false);
+  for (unsigned iO(0); iO != outputs_.size(); ++iO) {
+    selected_[iO] = passesSelection_(_event, outputs_[iO].selectEvents);
+    anySelected = anySelected || selected_[iO];
+  }
+
+  if (!anySelected) {
+    lastAnalyze_ = SClock::now();
+    return;
   }
 
-  eventCounter_->Fill(1.5);
+  for (unsigned iO(0); iO != outputs_.size(); ++iO) {
+    if (selected_[iO])
+      writers_()[iO]->countEvent(true);
+  }
 
   // Now fill the event
   outEvent_.init();
@@ -230,119 +635,216 @@ SUEPProducer::analyze(edm::Event const& _event, edm::EventSetup const& _setup)
   for (auto& mm : objectMaps_)
     mm.second.clearMaps();
 
+  pfCandidateSnapshot_.reset();
+  pfCandidateIndex_.reset();
+
   outEvent_.runNumber = _event.id().run();
   outEvent_.lumiNumber = _event.luminosityBlock();
   outEvent_.eventNumber = _event.id().event();
   outEvent_.isData = _event.isRealData();
 
-  for (unsigned iF(0); iF != fillers_.size(); ++iF) {
-    auto* filler(fillers_[iF]);
-    try {
-      if (printLevel_ >= 1) {
-        if (printLevel_ >= 2)
-          std::cout << "[SUEPProducer::fill] " 
-                    << "Calling " << filler->getName() << "->fill()" << std::endl;
+  inEvent_ = &_event;
+  inSetup_ = &_setup;
 
-        start = SClock::now();
-      }
+  if (fillerGraph_)
+    fillerGraph_->run();
+  else {
+    for (unsigned iF : activeFillers_)
+      fillStep_(iF);
 
-      filler->fill(outEvent_, _event, _setup);
+    // Set inter-branch references
+    for (unsigned iF : activeFillers_)
+      setRefsStep_(iF);
+  }
 
-      if (printLevel_ >= 1) {
-        auto dt(SClock::now() - start);
+  for (unsigned iO(0); iO != outputs_.size(); ++iO) {
+    if (selected_[iO])
+      writers_()[iO]->fillEvent(outEvent_);
+  }
 
-        if (printLevel_ >= 3)
-          std::cout << "[SUEPProducer::analyze] " 
-                    << "Step " << filler->getName() << "->fill() took " << toMS(dt) << " ms" << std::endl;
+  // scratch memory of the fillers is no longer referenced
+  for (unsigned iF : activeFillers_)
+    fillers_[iF]->releaseArena();
 
-        timers_[iF] += dt;
-      }
+  lastAnalyze_ = SClock::now();
+}
+
+bool
+SUEPProducer::passesSelection_(edm::Event const& _event, VString const& _paths) const
+{
+  // If path names are given, check if at least one succeeded
+  if (_paths.size() == 0)
+    return true;
+
+  edm::Handle<edm::TriggerResults> triggerResults;
+  if (!_event.getByToken(skimResultsToken_, triggerResults))
+    return true;
+
+  auto& pathNames(_event.triggerNames(*triggerResults));
+  for (auto& path : _paths) {
+    unsigned iP(pathNames.triggerIndex(path));
+    if (iP != pathNames.size() && triggerResults->accept(iP))
+      return true;
+  }
+
+  return false;
+}
+
+void
+SUEPProducer::fillStep_(unsigned _iF)
+{
+  auto* filler(fillers_[_iF]);
+  SClock::time_point start;
+
+  try {
+    if (timed_) {
+      if (printLevel_ >= 2)
+        std::cout << "[SUEPProducer::fill] "
+                  << "Calling " << filler->getName() << "->fill()" << std::endl;
+
+      start = SClock::now();
     }
-    catch (std::exception& ex) {
-      std::cerr << "[SUEPProducer::fill] " 
-        << "Error in " << filler->getName() << "::fill()" << std::endl;
-      throw;
+
+    {
+      auto* counts(allocationCounts_(_iF, kFill));
+      unsigned long long nBefore(counts ? counts->nAllocations : 0);
+      AllocationCounter::Scope allocationScope(counts);
+
+      filler->fill(outEvent_, *inEvent_, *inSetup_);
+
+      checkAllocations_(_iF, kFill, nBefore);
     }
+
+    if (timed_) {
+      auto dt(SClock::now() - start);
+
+      if (printLevel_ >= 3)
+        std::cout << "[SUEPProducer::analyze] "
+                  << "Step " << filler->getName() << "->fill() took " << toMS(dt) << " ms" << std::endl;
+
+      timers_[_iF] += dt;
+      latencies_[_iF * nPhases + kFill].fill(dt);
+    }
+  }
+  catch (std::exception& ex) {
+    std::cerr << "[SUEPProducer::fill] "
+      << "Error in " << filler->getName() << "::fill()" << std::endl;
+    throw;
   }
+}
 
-  // Set inter-branch references
-  for (unsigned iF(0); iF != fillers_.size(); ++iF) {
-    auto* filler(fillers_[iF]);
-    try {
-      if (printLevel_ >= 1) {
-        if (printLevel_ >= 2)
-          std::cout << "[SUEPProducer:fill] "
-                    << "Calling " << filler->getName() << "->setRefs()" << std::endl;
+void
+SUEPProducer::setRefsStep_(unsigned _iF)
+{
+  auto* filler(fillers_[_iF]);
+  SClock::time_point start;
 
-        start = SClock::now();
-      }
+  try {
+    if (timed_) {
+      if (printLevel_ >= 2)
+        std::cout << "[SUEPProducer:fill] "
+                  << "Calling " << filler->getName() << "->setRefs()" << std::endl;
 
-      filler->setRefs(objectMaps_);
+      start = SClock::now();
+    }
 
-      if (printLevel_ >= 1) {
-        auto dt(SClock::now() - start);
+    {
+      auto* counts(allocationCounts_(_iF, kSetRefs));
+      unsigned long long nBefore(counts ? counts->nAllocations : 0);
+      AllocationCounter::Scope allocationScope(counts);
 
-        if (printLevel_ >= 3)
-          std::cout << "[SUEPProducer::analyze] " 
-                    << "Step " << filler->getName() << "->setRefs() took " << toMS(dt) << " ms" << std::endl;
+      filler->setRefs(objectMaps_);
 
-        timers_[iF] += dt;
-      }
+      checkAllocations_(_iF, kSetRefs, nBefore);
     }
-    catch (std::exception& ex) {
-      std::cerr << "[SUEPProducer:fill] " 
-        << "Error in " << filler->getName() << "::setRefs()" << std::endl;
-      throw;
+
+    if (timed_) {
+      auto dt(SClock::now() - start);
+
+      if (printLevel_ >= 3)
+        std::cout << "[SUEPProducer::analyze] "
+                  << "Step " << filler->getName() << "->setRefs() took " << toMS(dt) << " ms" << std::endl;
+
+      timers_[_iF] += dt;
+      latencies_[_iF * nPhases + kSetRefs].fill(dt);
     }
   }
+  catch (std::exception& ex) {
+    std::cerr << "[SUEPProducer:fill] "
+      << "Error in " << filler->getName() << "::setRefs()" << std::endl;
+    throw;
+  }
+}
 
-  outEvent_.fill(*eventTree_);
+void
+SUEPProducer::checkAllocations_(unsigned _iF, Phase _phase, unsigned long long _nBefore) const
+{
+  if (zeroAllocationWarmup_ == 0 || nEvents_ <= zeroAllocationWarmup_)
+    return;
 
-  lastAnalyze_ = SClock::now();
+  unsigned long long nAllocations(allocations_[_iF * nPhases + _phase].nAllocations - _nBefore);
+  if (nAllocations == 0)
+    return;
+
+  char const* phaseNames[] = {"fillAll", "fill", "setRefs"};
+  throw edm::Exception(edm::errors::LogicError, fillers_[_iF]->getName() + "::" + phaseNames[_phase] + "() made " + std::to_string(nAllocations) + " heap allocations after the warm-up");
 }
 
 void
 SUEPProducer::beginRun(edm::Run const& _run, edm::EventSetup const& _setup)
 {
-  outEvent_.run.init();
+  {
+    // fillers may write to objects in the output file (e.g. the hlt tree)
+    std::lock_guard<std::mutex> lock(writer_().getMutex());
 
-  outEvent_.run.runNumber = _run.run();
+    outEvent_.run.init();
 
-  for (auto* filler : fillers_) {
-    try {
-      if (printLevel_ >= 2)
-        std::cout << "[SUEPProducer::beginRun] " 
-          << "Calling " << filler->getName() << "->fillBeginRun()" << std::endl;
+    outEvent_.run.runNumber = _run.run();
 
-      filler->fillBeginRun(outEvent_.run, _run, _setup);
-    }
-    catch (std::exception& ex) {
-      std::cerr << "[SUEPProducer::beginRun] "
-        << "Error in " << filler->getName() << "::fillBeginRun()" << std::endl;
-      throw;
+    for (auto* filler : fillers_) {
+      try {
+        if (printLevel_ >= 2)
+          std::cout << "[SUEPProducer::beginRun] "
+            << "Calling " << filler->getName() << "->fillBeginRun()" << std::endl;
+
+        filler->fillBeginRun(outEvent_.run, _run, _setup);
+      }
+      catch (std::exception& ex) {
+        std::cerr << "[SUEPProducer::beginRun] "
+          << "Error in " << filler->getName() << "::fillBeginRun()" << std::endl;
+        throw;
+      }
     }
   }
+
+  for (auto& writer : writers_())
+    writer->setCurrentRun(outEvent_.run);
 }
 
 void
 SUEPProducer::endRun(edm::Run const& _run, edm::EventSetup const& _setup)
 {
-  for (auto* filler : fillers_) {
-    try {
-      if (printLevel_ >= 2) 
-        std::cout << "[SUEPProducer::endRun] " 
-          << "Calling " << filler->getName() << "->fillEndRun()" << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(writer_().getMutex());
 
-      filler->fillEndRun(outEvent_.run, _run, _setup);
-    }
-    catch (std::exception& ex) {
-      std::cerr << "[SUEPProducer::endRun] "
-        << "Error in " << filler->getName() << "::fillEndRun()" << std::endl;
-      throw;
+    for (auto* filler : fillers_) {
+      try {
+        if (printLevel_ >= 2)
+          std::cout << "[SUEPProducer::endRun] "
+            << "Calling " << filler->getName() << "->fillEndRun()" << std::endl;
+
+        filler->fillEndRun(outEvent_.run, _run, _setup);
+      }
+      catch (std::exception& ex) {
+        std::cerr << "[SUEPProducer::endRun] "
+          << "Error in " << filler->getName() << "::fillEndRun()" << std::endl;
+        throw;
+      }
     }
   }
 
-  outEvent_.run.fill(*runTree_);
+  for (auto& writer : writers_())
+    writer->fillRun(outEvent_.run);
 }
 
 void
@@ -352,81 +854,28 @@ SUEPProducer::beginLuminosityBlock(edm::LuminosityBlock const& _lumi, edm::Event
 }
 
 void
-SUEPProducer::endLuminosityBlock(edm::LuminosityBlock const& _lumi, edm::EventSetup const& _setup)
+SUEPProducer::endLuminosityBlockSummary(edm::LuminosityBlock const& _lumi, edm::EventSetup const& _setup, SUEPLumiSummary* _summary) const
 {
-  outEvent_.runNumber = _lumi.id().run();
-  outEvent_.lumiNumber = _lumi.id().luminosityBlock();
-  lumiSummaryTree_->Fill();
+  // calls are serialized by the framework
+  _summary->nEvents += nEventsInLumi_;
 }
 
-void 
-SUEPProducer::beginJob()
+/*static*/
+std::shared_ptr<SUEPLumiSummary>
+SUEPProducer::globalBeginLuminosityBlockSummary(edm::LuminosityBlock const&, edm::EventSetup const&, LuminosityBlockContext const*)
 {
-  outputFile_ = TFile::Open(outputName_.c_str(), "recreate");
-  eventTree_ = new TTree("events", "");
-  runTree_ = new TTree("runs", "");
-  lumiSummaryTree_ = new TTree("lumiSummary", "");
-
-  suep::utils::BranchList eventBranches = {"runNumber", "lumiNumber", "eventNumber", "isData"};
-  suep::utils::BranchList runBranches = {"runNumber"};
-  for (auto* filler : fillers_)
-    filler->branchNames(eventBranches, runBranches);
-
-  outEvent_.book(*eventTree_, eventBranches);
-  outEvent_.run.book(*runTree_, runBranches);
-
-  lumiSummaryTree_->Branch("runNumber", &outEvent_.runNumber, "runNumber/i");
-  lumiSummaryTree_->Branch("lumiNumber", &outEvent_.lumiNumber, "lumiNumber/i");
-  lumiSummaryTree_->Branch("nEvents", &nEventsInLumi_, "nEventsInLumi_/i");
-
-  for (auto* filler : fillers_)
-    filler->addOutput(*outputFile_);
-
-  if (useTrigger_ && outputFile_->Get("hlt")) {
-    outEvent_.run.hlt.create();
-    auto& hltTree(*static_cast<TTree*>(outputFile_->Get("hlt")));
-    hltTree.Branch("menu", "TString", &outEvent_.run.hlt.menu);
-    hltTree.Branch("paths", "std::vector<TString>", &outEvent_.run.hlt.paths, 32000, 0);
-    hltTree.Branch("filters", "std::vector<TString>", &outEvent_.run.hlt.filters, 32000, 0);
-  }
-
-  eventCounter_ = new TH1D("eventcounter", "", 2, 0., 2.);
-  eventCounter_->SetDirectory(outputFile_);
-  eventCounter_->GetXaxis()->SetBinLabel(1, "all");
-  eventCounter_->GetXaxis()->SetBinLabel(2, "selected");
+  return std::make_shared<SUEPLumiSummary>();
 }
 
-void 
-SUEPProducer::endJob()
+/*static*/
+void
+SUEPProducer::globalEndLuminosityBlockSummary(edm::LuminosityBlock const& _lumi, edm::EventSetup const&, LuminosityBlockContext const* _context, SUEPLumiSummary* _summary)
 {
-  // writes out all outputs that are still hanging in the directory
-  outputFile_->cd();
-  outputFile_->Write();
-  delete outputFile_;
-
-  if (printLevel_ >= 1) {
-    double total(0.);
-
-    std::cout << "[SUEPProducer::endJob] Timer summary" << std::endl;
-    for (unsigned iF(0); iF != fillers_.size(); ++iF) {
-      double msPerEvt(toMS(timers_[iF]) / nEvents_);
-      std::cout << " " << fillers_[iF]->getName() << "  "
-                << std::fixed << std::setprecision(3) << msPerEvt << " ms/evt"
-                << std::endl;
+  for (auto& writer : _context->global()->writers) {
+    writer->fillLumiSummary(_lumi.id().run(), _lumi.id().luminosityBlock(), _summary->nEvents);
 
-      total += msPerEvt;
-    }
-    if (nEvents_ > 1) {
-      double msPerEvt(toMS(timers_.back()) / (nEvents_ - 1));
-      std::cout << " Other CMSSW  "
-                << std::fixed << std::setprecision(3) << msPerEvt << " ms/evt"
-                << std::endl;
-
-      total += msPerEvt;
-    }
-    std::cout << std::endl << " Total  "
-              << std::fixed << std::setprecision(3) << total << " ms/evt"
-              << std::endl;
+    // all streams are done with this luminosity block
+    writer->rolloverIfDue();
   }
 }
 
@@ -11,6 +11,8 @@ options.register('isData', default = False, mult = VarParsing.multiplicity.singl
 options.register('useTrigger', default = True, mult = VarParsing.multiplicity.singleton, mytype = VarParsing.varType.bool, info = 'Fill trigger information')
 options.register('printLevel', default = 0, mult = VarParsing.multiplicity.singleton, mytype = VarParsing.varType.int, info = 'Debug level of the ntuplizer')
 options.register('skipEvents', default = 0, mult = VarParsing.multiplicity.singleton, mytype = VarParsing.varType.int, info = 'Skip first events')
+options.register('nThreads', default = 1, mult = VarParsing.multiplicity.singleton, mytype = VarParsing.varType.int, info = 'Number of threads (and streams) for the CMSSW job')
+options.register('outputQueueSize', default = 0, mult = VarParsing.multiplicity.singleton, mytype = VarParsing.varType.int, info = 'Number of events buffered for the output writer thread (0 = write synchronously)')
 options.register('dumpPython', default = False, mult = VarParsing.multiplicity.singleton, mytype = VarParsing.varType.bool, info = 'Dumps configuration as single python file to stdout')
 options._tags.pop('numEvent%d')
 options._tagOrder.remove('numEvent%d')
@@ -3,9 +3,46 @@ import FWCore.ParameterSet.Config as cms
 suep = cms.EDAnalyzer('SUEPProducer',
     isRealData = cms.untracked.bool(False),
     outputFile = cms.untracked.string('suep.root'),
+    # > 0: fill the events tree in a separate thread, buffering up to this many events
+    outputQueueSize = cms.untracked.uint32(0),
+    # ALGORITHM:level for the output file; ALGORITHM is ZLIB, LZMA, LZ4 (or ZSTD with ROOT >= 6.20)
+    compression = cms.untracked.string('ZLIB:1'),
+    # per-branch overrides, e.g. 'pfCandidates=LZ4:4' (applies to pfCandidates.*)
+    branchCompression = cms.untracked.vstring(),
+    # initial basket size in bytes of the event branches (0 = ROOT default)
+    basketSize = cms.untracked.int32(0),
+    # per-branch basket sizes in bytes, e.g. 'pfCandidates=1048576' (applies to pfCandidates.*)
+    # other branches are resized by ROOT from their observed sizes at the first flush; these keep the given size
+    branchBasketSize = cms.untracked.vstring(),
+    # events tree cluster size: > 0 events, < 0 compressed bytes, 0 = ROOT default
+    autoFlush = cms.untracked.int64(0),
+    # > 0: start a new output file (suep_1.root, ...) at the end of the lumi in which the limit is reached
+    # (requires process.options.numberOfConcurrentLuminosityBlocks = 1)
+    maxEventsPerFile = cms.untracked.uint32(0),
+    maxFileSize = cms.untracked.uint32(0), # MB
+    # converter, not an output backend: if set, the events tree of each output file is copied to an RNTuple in this file
+    # at the end of the job (ROOT >= 6.30); the closed files are read back in full, which adds to the endJob time
+    convertToRNTuple = cms.untracked.string(''),
+    # also write a small 'summary' tree (run/lumi/event, npv, leading jet pts, MET, multiplicities, trigger bits) aligned with the events tree
+    writeSummary = cms.untracked.bool(False),
+    # build a TTreeIndex on (runNumber, eventNumber) for the events tree (reads back the tree at file close)
+    buildEventIndex = cms.untracked.bool(False),
+    # save compressed / uncompressed sizes per collection and filler (branchSizes tree) and print a summary at endJob
+    reportBranchSizes = cms.untracked.bool(False),
     useTrigger = cms.untracked.bool(True),
     SelectEvents = cms.untracked.vstring(),
+    # branches to remove from the output, e.g. 'tracks' or 'puppiAK8Jets.ecfs'
+    dropBranches = cms.untracked.vstring(),
+    # several outputs from one pass, e.g. cms.untracked.PSet(outputFile = cms.untracked.string('skim.root'), SelectEvents = cms.untracked.vstring('skim'))
+    # parameters not set in an output PSet are taken from above; empty = single output with the parameters above
+    outputs = cms.untracked.VPSet(),
     printLevel = cms.untracked.uint32(0),
+    recordTiming = cms.untracked.bool(False),
+    concurrentFillers = cms.untracked.bool(False),
+    # count heap allocations per filler step (needs LD_PRELOAD=libSUEPProdProducer.so)
+    countAllocations = cms.untracked.bool(False),
+    # > 0: fail if a filler step allocates after this many events (implies countAllocations)
+    zeroAllocationWarmup = cms.untracked.uint32(0),
     fillers = cms.untracked.PSet(
         common = cms.untracked.PSet(
             genEventInfo = cms.untracked.string('generator'),
@@ -202,7 +239,14 @@ suep = cms.EDAnalyzer('SUEPProducer',
             filler = cms.untracked.string('PFCands'),
             puppiMap = cms.untracked.string('puppi'),
             puppiInput = cms.untracked.string('packedPFCandidates'),
-            useExistingWeights = cms.untracked.bool(True)
+            useExistingWeights = cms.untracked.bool(True),
+            # write only the candidates passing the cuts below (and those referenced by keepReferencedBy)
+            thinning = cms.untracked.bool(False),
+            defaultMinPt = cms.untracked.double(0.),
+            minPtByPdgId = cms.untracked.vstring(), # e.g. '130:1.', '22:1.'
+            minPuppiWeight = cms.untracked.double(-1.),
+            minChargedFromPV = cms.untracked.int32(0), # pat::PackedCandidate::PVAssociationQuality; 0 = no requirement
+            keepReferencedBy = cms.untracked.vstring() # e.g. 'slimmedJets', 'slimmedSecondaryVertices', 'slimmedMuons', 'slimmedPhotons'
         ),
         partons = cms.untracked.PSet(
             enabled = cms.untracked.bool(True),
@@ -301,7 +345,9 @@ suep = cms.EDAnalyzer('SUEPProducer',
         weights = cms.untracked.PSet(
             enabled = cms.untracked.bool(True),
             filler = cms.untracked.string('Weights'),
-            pdfType = cms.untracked.string('')
+            pdfType = cms.untracked.string(''),
+            # save the signal reweighting factors (genReweight.genParam)
+            genParam = cms.untracked.bool(True)
         ),
         recoil = cms.untracked.PSet(
             enabled = cms.untracked.bool(True),
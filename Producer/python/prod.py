@@ -31,7 +31,7 @@ import FWCore.ParameterSet.Config as cms
 process = cms.Process('NTUPLES')
 
 process.options = cms.untracked.PSet(
-    numberOfThreads = cms.untracked.uint32(1),
+    numberOfThreads = cms.untracked.uint32(options.nThreads),
     numberOfStreams = cms.untracked.uint32(0)
 )
 
@@ -457,6 +457,7 @@ process.suep.fillers.muons.rochesterCorrectionSource = 'SUEPProd/Utilities/data/
 
 process.suep.outputFile = options.outputFile
 process.suep.printLevel = options.printLevel
+process.suep.outputQueueSize = options.outputQueueSize
 
 process.ntuples = cms.EndPath(process.suep)
 
@@ -0,0 +1,138 @@
+#include "../interface/AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+  thread_local AllocationCounter::Counts* currentCounts(0);
+
+  void*
+  allocate(std::size_t _size)
+  {
+    AllocationCounter::record(_size);
+
+    if (_size == 0)
+      _size = 1;
+
+    void* p(0);
+    while (!(p = std::malloc(_size))) {
+      auto handler(std::get_new_handler());
+      if (!handler)
+        throw std::bad_alloc();
+      handler();
+    }
+
+    return p;
+  }
+}
+
+AllocationCounter::Scope::Scope(Counts* _counts) :
+  set_(_counts != 0)
+{
+  if (set_) {
+    ++_counts->nScopes;
+    previous_ = currentCounts;
+    currentCounts = _counts;
+  }
+}
+
+AllocationCounter::Scope::~Scope()
+{
+  if (set_)
+    currentCounts = previous_;
+}
+
+/*static*/
+bool
+AllocationCounter::isActive()
+{
+  Counts counts;
+  {
+    Scope scope(&counts);
+    // explicit call - new-expressions may be optimized away
+    ::operator delete(::operator new(1));
+  }
+  return counts.nAllocations != 0;
+}
+
+/*static*/
+void
+AllocationCounter::record(std::size_t _size)
+{
+  if (currentCounts) {
+    ++currentCounts->nAllocations;
+    currentCounts->nBytes += _size;
+  }
+}
+
+// Replacements of the global allocation functions. Memory comes from malloc as in the default implementation.
+
+void*
+operator new(std::size_t _size)
+{
+  return allocate(_size);
+}
+
+void*
+operator new[](std::size_t _size)
+{
+  return allocate(_size);
+}
+
+void*
+operator new(std::size_t _size, std::nothrow_t const&) noexcept
+{
+  try {
+    return allocate(_size);
+  }
+  catch (std::bad_alloc&) {
+    return 0;
+  }
+}
+
+void*
+operator new[](std::size_t _size, std::nothrow_t const&) noexcept
+{
+  try {
+    return allocate(_size);
+  }
+  catch (std::bad_alloc&) {
+    return 0;
+  }
+}
+
+void
+operator delete(void* _p) noexcept
+{
+  std::free(_p);
+}
+
+void
+operator delete[](void* _p) noexcept
+{
+  std::free(_p);
+}
+
+void
+operator delete(void* _p, std::size_t) noexcept
+{
+  std::free(_p);
+}
+
+void
+operator delete[](void* _p, std::size_t) noexcept
+{
+  std::free(_p);
+}
+
+void
+operator delete(void* _p, std::nothrow_t const&) noexcept
+{
+  std::free(_p);
+}
+
+void
+operator delete[](void* _p, std::nothrow_t const&) noexcept
+{
+  std::free(_p);
+}
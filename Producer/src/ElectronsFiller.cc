@@ -9,7 +9,6 @@
 #include "DataFormats/EgammaCandidates/interface/Conversion.h"
 #include "DataFormats/PatCandidates/interface/Electron.h"
 #include "DataFormats/HepMCCandidate/interface/GenStatusFlags.h"
-#include "DataFormats/Math/interface/deltaR.h"
 
 #include <cmath>
 
@@ -52,6 +51,18 @@ ElectronsFiller::ElectronsFiller(std::string const& _name, edm::ParameterSet con
   getToken_(rhoToken_, _cfg, _coll, "rho", "rho");
   getToken_(rhoCentralCaloToken_, _cfg, _coll, "rho", "rhoCentralCalo");
   getToken_(verticesToken_, _cfg, _coll, "common", "vertices");
+
+  registerObjectMap_(eleEleMap_);
+  registerObjectMap_(scEleMap_);
+  registerObjectMap_(pfEleMap_, "pf");
+  registerObjectMap_(vtxEleMap_);
+  registerObjectMap_(genEleMap_, "gen");
+
+  consumesObjectMap_(scMap_, "superClusters");
+  consumesObjectMap_(pfMap_, "pfCandidates");
+  consumesObjectMap_(vtxMap_, "vertices");
+  if (!isRealData_)
+    consumesObjectMap_(genMap_, "genParticles");
 }
 
 void
@@ -113,21 +124,14 @@ ElectronsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::E
       return &*hitItr;
     });
 
-  auto findPF([&pfCandidates](reco::GsfElectron const& inElectron)->reco::CandidatePtr {
-      int iMatch(-1);
-
-      double minDR(0.1);
-      for (unsigned iPF(0); iPF != pfCandidates.size(); ++iPF) {
-        auto& pf(pfCandidates.at(iPF));
-        if (std::abs(pf.pdgId()) != 11 || pf.pdgId() == 22)
-          continue;
+  auto& candSnapshot(getPFCandidateSnapshot_(pfCandidates));
+  auto& pfIndex(getPFCandidateIndex_(pfCandidates));
 
-        double dR(reco::deltaR(pf, inElectron));
-        if (dR < minDR) {
-          minDR = dR;
-          iMatch = iPF;
-        }
-      }
+  auto findPF([&pfCandidates, &candSnapshot, &pfIndex](reco::GsfElectron const& inElectron)->reco::CandidatePtr {
+      // closest PF electron within dR < 0.1
+      int iMatch(pfIndex.nearest(inElectron.eta(), inElectron.phi(), 0.1, [&candSnapshot](unsigned iPF) {
+            return std::abs(candSnapshot.pdgId(iPF)) == 11;
+          }));
 
       if (iMatch >= 0)
         return pfCandidates.ptrAt(iMatch);
@@ -278,11 +282,11 @@ ElectronsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::E
   auto originalIndices(outElectrons.sort(suep::Particle::PtGreater));
 
   // make reco <-> suep mapping
-  auto& eleEleMap(objectMap_->get<reco::GsfElectron, suep::Electron>());
-  auto& scEleMap(objectMap_->get<reco::SuperCluster, suep::Electron>());
-  auto& pfEleMap(objectMap_->get<reco::Candidate, suep::Electron>("pf"));
-  auto& vtxEleMap(objectMap_->get<reco::Vertex, suep::Electron>());
-  auto& genEleMap(objectMap_->get<reco::Candidate, suep::Electron>("gen"));
+  auto& eleEleMap(*eleEleMap_);
+  auto& scEleMap(*scEleMap_);
+  auto& pfEleMap(*pfEleMap_);
+  auto& vtxEleMap(*vtxEleMap_);
+  auto& genEleMap(*genEleMap_);
   
   for (unsigned iP(0); iP != outElectrons.size(); ++iP) {
     auto& outElectron(outElectrons[iP]);
@@ -314,49 +318,53 @@ ElectronsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::E
 }
 
 void
-ElectronsFiller::setRefs(ObjectMapStore const& _objectMaps)
+ElectronsFiller::setRefs(ObjectMapStore const&)
 {
-  auto& scEleMap(objectMap_->get<reco::SuperCluster, suep::Electron>());
-  auto& pfEleMap(objectMap_->get<reco::Candidate, suep::Electron>("pf"));
-  auto& vtxEleMap(objectMap_->get<reco::Vertex, suep::Electron>());
+  auto& scEleMap(*scEleMap_);
+  auto& pfEleMap(*pfEleMap_);
+  auto& vtxEleMap(*vtxEleMap_);
 
-  auto& scMap(_objectMaps.at("superClusters").get<reco::SuperCluster, suep::SuperCluster>().fwdMap);
-  auto& pfMap(_objectMaps.at("pfCandidates").get<reco::Candidate, suep::PFCand>().fwdMap);
-  auto& vtxMap(_objectMaps.at("vertices").get<reco::Vertex, suep::RecoVertex>().fwdMap);
+  auto& scMap(*scMap_);
+  auto& pfMap(*pfMap_);
+  auto& vtxMap(*vtxMap_);
 
-  for (auto& link : scEleMap.bwdMap) { // suep -> edm
-    auto& outElectron(*link.first);
-    auto& scPtr(link.second);
+  for (auto& link : scEleMap) { // suep -> edm
+    auto& outElectron(*link.suepObj);
+    auto& scPtr(link.edmPtr);
 
     outElectron.superCluster.setRef(scMap.at(scPtr));
   }
 
-  for (auto& link : pfEleMap.bwdMap) { // suep -> edm
-    auto& outElectron(*link.first);
-    auto& pfPtr(link.second);
+  for (auto& link : pfEleMap) { // suep -> edm
+    auto& outElectron(*link.suepObj);
+    auto& pfPtr(link.edmPtr);
 
-    outElectron.matchedPF.setRef(pfMap.at(pfPtr));
+    // may be missing if the PF candidates are thinned
+    auto* outPF(pfMap.find(pfPtr));
+    if (outPF)
+      outElectron.matchedPF.setRef(outPF);
   }
 
-  for (auto& link : vtxEleMap.bwdMap) { // suep -> edm
-    auto& outElectron(*link.first);
-    auto& vtxPtr(link.second);
+  for (auto& link : vtxEleMap) { // suep -> edm
+    auto& outElectron(*link.suepObj);
+    auto& vtxPtr(link.edmPtr);
 
     outElectron.vertex.setRef(vtxMap.at(vtxPtr));
   }
 
   if (!isRealData_) {
-    auto& genEleMap(objectMap_->get<reco::Candidate, suep::Electron>("gen"));
+    auto& genEleMap(*genEleMap_);
 
-    auto& genMap(_objectMaps.at("genParticles").get<reco::Candidate, suep::GenParticle>().fwdMap);
+    auto& genMap(*genMap_);
 
-    for (auto& link : genEleMap.bwdMap) {
-      auto& genPtr(link.second);
-      if (genMap.find(genPtr) == genMap.end())
+    for (auto& link : genEleMap) {
+      auto& genPtr(link.edmPtr);
+      auto* outGen(genMap.find(genPtr));
+      if (!outGen)
         continue;
 
-      auto& outElectron(*link.first);
-      outElectron.matchedGen.setRef(genMap.at(genPtr));
+      auto& outElectron(*link.suepObj);
+      outElectron.matchedGen.setRef(outGen);
     }
   }
 }
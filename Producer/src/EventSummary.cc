@@ -0,0 +1,61 @@
+#include "../interface/EventSummary.h"
+
+#include <string>
+
+namespace {
+  void
+  setLeadingPts(float* _pts, suep::JetCollection const& _jets, unsigned _n)
+  {
+    for (unsigned iJ(0); iJ != _n; ++iJ)
+      _pts[iJ] = iJ < _jets.size() ? _jets[iJ].pt() : 0.;
+  }
+}
+
+void
+EventSummary::book(TTree& _tree)
+{
+  std::string jetsLeaf("[" + std::to_string(nJets) + "]/F");
+  std::string triggerLeaf("triggerBits[" + std::to_string(nTriggerWords) + "]/l");
+
+  _tree.Branch("runNumber", &runNumber_, "runNumber/i");
+  _tree.Branch("lumiNumber", &lumiNumber_, "lumiNumber/i");
+  _tree.Branch("eventNumber", &eventNumber_, "eventNumber/l");
+  _tree.Branch("npv", &npv_, "npv/i");
+  _tree.Branch("nVertices", &nVertices_, "nVertices/i");
+  _tree.Branch("chsAK4JetPt", chsAK4JetPt_, ("chsAK4JetPt" + jetsLeaf).c_str());
+  _tree.Branch("puppiAK4JetPt", puppiAK4JetPt_, ("puppiAK4JetPt" + jetsLeaf).c_str());
+  _tree.Branch("puppiAK8JetPt", &puppiAK8JetPt_, "puppiAK8JetPt/F");
+  _tree.Branch("pfMet", &pfMet_, "pfMet/F");
+  _tree.Branch("puppiMet", &puppiMet_, "puppiMet/F");
+  _tree.Branch("nTracks", &nTracks_, "nTracks/i");
+  _tree.Branch("nPFCandidates", &nPFCandidates_, "nPFCandidates/i");
+  _tree.Branch("triggerBits", triggerBits_, triggerLeaf.c_str());
+}
+
+void
+EventSummary::set(suep::Event const& _event)
+{
+  runNumber_ = _event.runNumber;
+  lumiNumber_ = _event.lumiNumber;
+  eventNumber_ = _event.eventNumber;
+  npv_ = _event.npv;
+  nVertices_ = _event.vertices.size();
+
+  // jet collections are pt-ordered by the fillers
+  setLeadingPts(chsAK4JetPt_, _event.chsAK4Jets, nJets);
+  setLeadingPts(puppiAK4JetPt_, _event.puppiAK4Jets, nJets);
+  setLeadingPts(&puppiAK8JetPt_, _event.puppiAK8Jets, 1);
+
+  pfMet_ = _event.pfMet.pt;
+  puppiMet_ = _event.puppiMet.pt;
+  nTracks_ = _event.tracks.size();
+  nPFCandidates_ = _event.pfCandidates.size();
+
+  for (unsigned iW(0); iW != nTriggerWords; ++iW) {
+    triggerBits_[iW] = 0;
+    for (unsigned iB(0); iB != 64; ++iB) {
+      if (_event.triggers.pass(iW * 64 + iB))
+        triggerBits_[iW] |= (1ULL << iB);
+    }
+  }
+}
@@ -0,0 +1,1126 @@
+#include "../interface/EventWriter.h"
+
+#include "FWCore/Utilities/interface/EDMException.h"
+
+#include "TKey.h"
+#include "TList.h"
+#include "TBranch.h"
+#include "RVersion.h"
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 30, 0)
+#include "ROOT/RNTupleImporter.hxx"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+namespace {
+  double toMS(EventWriter::Duration const& interval)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count() * 1.e-6;
+  }
+}
+
+EventWriter::EventWriter(edm::ParameterSet const& _cfg) :
+  outputName_(_cfg.getUntrackedParameter<std::string>("outputFile", "suep.root")),
+  printLevel_(_cfg.getUntrackedParameter<unsigned>("printLevel", 0)),
+  queueSize_(_cfg.getUntrackedParameter<unsigned>("outputQueueSize", 0)),
+  recordTiming_(_cfg.getUntrackedParameter<bool>("recordTiming", false)),
+  compression_(parseCompression_(_cfg.getUntrackedParameter<std::string>("compression", "ZLIB:1"))),
+  basketSize_(_cfg.getUntrackedParameter<int>("basketSize", 0)),
+  autoFlush_(_cfg.getUntrackedParameter<long long>("autoFlush", 0)),
+  maxEventsPerFile_(_cfg.getUntrackedParameter<unsigned>("maxEventsPerFile", 0)),
+  maxFileSize_(_cfg.getUntrackedParameter<unsigned>("maxFileSize", 0) * 1024LL * 1024LL),
+  rntupleName_(_cfg.getUntrackedParameter<std::string>("convertToRNTuple", "")),
+  writeSummary_(_cfg.getUntrackedParameter<bool>("writeSummary", false)),
+  buildEventIndex_(_cfg.getUntrackedParameter<bool>("buildEventIndex", false)),
+  reportBranchSizes_(_cfg.getUntrackedParameter<bool>("reportBranchSizes", false)),
+  outEvent_()
+{
+#if ROOT_VERSION_CODE < ROOT_VERSION(6, 30, 0)
+  if (!rntupleName_.empty())
+    throw edm::Exception(edm::errors::Configuration, "RNTuple conversion (convertToRNTuple) requires ROOT >= 6.30");
+#endif
+
+  if (!rntupleName_.empty() && rntupleName_ == outputName_)
+    throw edm::Exception(edm::errors::Configuration, "convertToRNTuple must differ from outputFile");
+
+  for (auto& spec : _cfg.getUntrackedParameter<std::vector<std::string>>("branchCompression", std::vector<std::string>())) {
+    size_t eq(spec.find('='));
+    if (eq == std::string::npos || eq == 0)
+      throw edm::Exception(edm::errors::Configuration, "Invalid branchCompression entry " + spec + " (expected branch=ALGORITHM:level)");
+
+    branchCompression_.emplace_back(spec.substr(0, eq), parseCompression_(spec.substr(eq + 1)));
+  }
+
+  for (auto& spec : _cfg.getUntrackedParameter<std::vector<std::string>>("branchBasketSize", std::vector<std::string>())) {
+    size_t eq(spec.find('='));
+    int size(eq == std::string::npos ? 0 : std::atoi(spec.c_str() + eq + 1));
+    if (eq == 0 || size <= 0)
+      throw edm::Exception(edm::errors::Configuration, "Invalid branchBasketSize entry " + spec + " (expected branch=bytes)");
+
+    branchBasketSizes_.emplace_back(spec.substr(0, eq), size);
+  }
+
+  for (unsigned iB(0); iB != queueSize_; ++iB) {
+    buffers_.emplace_back(new Buffer);
+    freeBuffers_.push_back(buffers_.back().get());
+  }
+}
+
+EventWriter::~EventWriter()
+{
+  // close() is expected to have been called at endJob; the thread is still running only if the job failed
+  if (writerThread_.joinable())
+    stopWriter_();
+
+  delete outputFile_;
+}
+
+void
+EventWriter::open()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  openFile_();
+
+  if (queueSize_ != 0)
+    writerThread_ = std::thread([this]() { this->writeLoop_(); });
+}
+
+void
+EventWriter::openFile_()
+{
+  // called with the mutex locked
+  outputFile_ = TFile::Open(indexedName_(outputName_).c_str(), "recreate", "", compression_);
+  eventTree_ = new TTree("events", "");
+  runTree_ = new TTree("runs", "");
+  lumiSummaryTree_ = new TTree("lumiSummary", "");
+
+  lumiSummaryTree_->Branch("runNumber", &lumiRunNumber_, "runNumber/i");
+  lumiSummaryTree_->Branch("lumiNumber", &lumiNumber_, "lumiNumber/i");
+  lumiSummaryTree_->Branch("nEvents", &nEventsInLumi_, "nEventsInLumi_/i");
+  lumiSummaryTree_->Branch("firstEntry", &lumiFirstEntry_, "firstEntry/L");
+  lumiSummaryTree_->Branch("lastEntry", &lumiLastEntry_, "lastEntry/L");
+  lumiSummaryTree_->Branch("entries", &lumiEntryList_);
+
+  eventCounter_ = new TH1D("eventcounter", "", 2, 0., 2.);
+  eventCounter_->SetDirectory(outputFile_);
+  eventCounter_->GetXaxis()->SetBinLabel(1, "all");
+  eventCounter_->GetXaxis()->SetBinLabel(2, "selected");
+
+  if (writeSummary_) {
+    // a separate tree has its own clusters; reading it does not touch the events baskets
+    summaryTree_ = new TTree("summary", "");
+    summary_.book(*summaryTree_);
+  }
+
+  nAllAtOpen_ = nAll_;
+  nSelectedAtOpen_ = nSelected_;
+  nEventsInFile_ = 0;
+
+  weightsTree_ = 0;
+  genParamBranch_ = 0;
+
+  if (booked_)
+    outEvent_.run.book(*runTree_, runBranches_);
+
+  if (bookedEvent_) {
+    bookedEvent_->book(*eventTree_, eventBranches_);
+    for (auto* extension : bookedExtensions_)
+      extension->book(*eventTree_);
+
+    configureEventTree_();
+  }
+
+  if (genParamExpected_) {
+    // new file after a rollover
+    std::lock_guard<std::mutex> idsLock(genParamMutex_);
+    if (genParamIdsSet_)
+      bookGenParam_();
+    else
+      genParamPending_ = true;
+  }
+}
+
+void
+EventWriter::closeFile_()
+{
+  // called with the mutex locked
+  unsigned long long nAll(nAll_ - nAllAtOpen_);
+  unsigned long long nSelected(nSelected_ - nSelectedAtOpen_);
+
+  eventCounter_->SetBinContent(1, nAll);
+  eventCounter_->SetBinContent(2, nSelected);
+  eventCounter_->SetEntries(nAll + nSelected);
+
+  if (genParamPending_) {
+    std::lock_guard<std::mutex> idsLock(genParamMutex_);
+    if (genParamIdsSet_)
+      bookGenParam_();
+    else if (!pendingGenParam_.empty())
+      std::cerr << "[EventWriter::closeFile_] "
+                << "No stream has set the genReweight.genParam ids; the values are not saved in " << outputFile_->GetName() << std::endl;
+
+    pendingGenParam_.clear();
+  }
+
+  if (buildEventIndex_ && eventTree_->GetEntries() != 0) {
+    if (printLevel_ >= 1)
+      std::cout << "[EventWriter::closeFile_] "
+                << "Building the (runNumber, eventNumber) index of the events tree" << std::endl;
+
+    eventTree_->BuildIndex("runNumber", "eventNumber");
+  }
+
+  if (reportBranchSizes_)
+    recordBranchSizes_();
+
+  // writes out all outputs that are still hanging in the directory
+  outputFile_->cd();
+  outputFile_->Write();
+  delete outputFile_;
+  outputFile_ = 0;
+
+  if (!rntupleName_.empty())
+    rntupleConversions_.emplace_back(indexedName_(outputName_), indexedName_(rntupleName_));
+}
+
+std::string
+EventWriter::indexedName_(std::string const& _name) const
+{
+  if (fileIndex_ == 0)
+    return _name;
+
+  // suep.root -> suep_1.root
+  std::string fileName(_name);
+  size_t dot(fileName.rfind(".root"));
+  fileName.insert(dot == std::string::npos ? fileName.size() : dot, "_" + std::to_string(fileIndex_));
+  return fileName;
+}
+
+void
+EventWriter::writeRNTuple_(std::string const& _sourceName, std::string const& _destName) const
+{
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 30, 0)
+  auto start(std::chrono::steady_clock::now());
+
+  // the importer opens the destination in update mode; start from an empty file
+  delete TFile::Open(_destName.c_str(), "recreate");
+
+  ROOT::Experimental::RNTupleWriteOptions options;
+  options.SetCompression(compression_);
+
+  auto importer(ROOT::Experimental::RNTupleImporter::Create(_sourceName, "events", _destName));
+  importer->SetWriteOptions(options);
+  importer->SetIsQuiet(printLevel_ < 2);
+  importer->Import();
+
+  if (printLevel_ >= 1)
+    std::cout << "[EventWriter::writeRNTuple_] "
+              << "Converted the events tree of " << _sourceName << " to " << _destName << " in "
+              << toMS(std::chrono::steady_clock::now() - start) << " ms" << std::endl;
+#endif
+}
+
+void
+EventWriter::book(suep::Event& _streamEvent, std::vector<EventExtension*> const& _extensions, suep::utils::BranchList const& _eventBranches, suep::utils::BranchList const& _runBranches)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  streamEvents_.push_back(StreamEvent{&_streamEvent, _extensions});
+
+  if (booked_)
+    return;
+
+  // kept for the trees of the following files
+  eventBranches_ = _eventBranches;
+  runBranches_ = _runBranches;
+
+  for (auto* extension : _extensions) {
+    outExtensions_.push_back(extension->clone());
+
+    for (auto& buffer : buffers_) {
+      buffer->ownedExtensions.push_back(extension->clone());
+      buffer->extensions.push_back(buffer->ownedExtensions.back().get());
+    }
+  }
+
+  outEvent_.run.book(*runTree_, _runBranches);
+
+  booked_ = true;
+}
+
+void
+EventWriter::bookEventTree_()
+{
+  // called from fillTree_() with the mutex locked; all streams have called book()
+  if (queueSize_ == 0 && streamEvents_.size() == 1) {
+    bookedEvent_ = streamEvents_[0].event;
+    bookedExtensions_ = streamEvents_[0].extensions;
+  }
+  else {
+    bookedEvent_ = &outEvent_;
+    for (auto& extension : outExtensions_)
+      bookedExtensions_.push_back(extension.get());
+  }
+
+  bookedEvent_->book(*eventTree_, eventBranches_);
+  for (auto* extension : bookedExtensions_)
+    extension->book(*eventTree_);
+
+  configureEventTree_();
+}
+
+std::vector<EventExtension*> const&
+EventWriter::streamExtensions_(suep::Event const& _event) const
+{
+  // streamEvents_ is complete before the first event
+  for (auto& streamEvent : streamEvents_) {
+    if (streamEvent.event == &_event)
+      return streamEvent.extensions;
+  }
+
+  throw edm::Exception(edm::errors::LogicError, "EventWriter::fillEvent called with an event that was not booked");
+}
+
+void
+EventWriter::expectGenParam()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (genParamExpected_)
+    return;
+
+  genParamExpected_ = true;
+  genParamPending_ = true;
+}
+
+void
+EventWriter::setGenParamIds(std::vector<TString> const& _ids)
+{
+  // called from the end-of-run and rollover hooks of the fillers, which may hold the writer mutex
+  std::lock_guard<std::mutex> idsLock(genParamMutex_);
+
+  if (!genParamIdsSet_) {
+    genParamIds_ = _ids;
+    genParamIdsSet_ = true;
+    return;
+  }
+
+  // streams learn separately; a matching shorter list is fine (the stream fills -1 beyond it)
+  if (_ids.size() > genParamIds_.size() || !std::equal(_ids.begin(), _ids.end(), genParamIds_.begin()))
+    std::cerr << "[EventWriter::setGenParamIds] "
+              << "Signal weights learned by another stream differ from the " << genParamIds_.size() << " saved ones; the others are not saved" << std::endl;
+}
+
+void
+EventWriter::bookGenParam_()
+{
+  // called with the mutex locked, in the current file
+  genParamPending_ = false;
+
+  if (!genParamIds_.empty()) {
+    TDirectory::TContext context(outputFile_);
+
+    weightsTree_ = new TTree("weights", "weights");
+    TString wid;
+    auto* widPtr(&wid);
+    weightsTree_->Branch("id", "TString", &widPtr); // currently only have the ability to save ID
+    for (auto& id : genParamIds_) {
+      wid = id;
+      weightsTree_->Fill();
+    }
+    weightsTree_->ResetBranchAddresses();
+
+    nGenParam_ = std::min<unsigned>(genParamIds_.size(), suep::GenReweight::NMAX);
+    genParamBranch_ = eventTree_->Branch("genReweight.genParam", genParam_, TString::Format("genParam[%d]/F", int(nGenParam_)));
+    configureBranch_(*genParamBranch_);
+
+    // backfill the events written before the ids were known
+    for (size_t offset(0); offset < pendingGenParam_.size(); offset += suep::GenReweight::NMAX) {
+      std::copy_n(pendingGenParam_.begin() + offset, nGenParam_, genParam_);
+      genParamBranch_->Fill();
+    }
+  }
+
+  pendingGenParam_.clear();
+}
+
+void
+EventWriter::close()
+{
+  if (writerThread_.joinable()) {
+    // write out the queued events
+    stopWriter_();
+
+    if (writerError_)
+      std::rethrow_exception(writerError_);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // timing of the whole job goes to the last file
+    if (recordTiming_)
+      writeLatencies_();
+
+    closeFile_();
+
+    if (printLevel_ >= 1)
+      printTimers_();
+
+    if (!allocations_.empty())
+      printAllocations_();
+
+    if (reportBranchSizes_)
+      printBranchSizes_();
+  }
+
+  // all files are closed and no stream writes anymore; the conversion reads each file back in full
+  for (auto& conversion : rntupleConversions_)
+    writeRNTuple_(conversion.first, conversion.second);
+}
+
+void
+EventWriter::setBranchOwners(std::vector<std::pair<std::string, suep::utils::BranchList>> const& _owners)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (branchOwners_.empty())
+    branchOwners_ = _owners;
+}
+
+void
+EventWriter::configureEventTree_()
+{
+  // called from bookEventTree_() and openFile_() with the mutex locked
+  if (basketSize_ > 0)
+    eventTree_->SetBasketSize("*", basketSize_);
+
+  if (autoFlush_ != 0)
+    eventTree_->SetAutoFlush(autoFlush_);
+
+  for (auto& bc : branchCompression_) {
+    unsigned nMatched(forEachMatchingBranch_(bc.first, [&bc](TBranch& branch) { branch.SetCompressionSettings(bc.second); }));
+
+    if (nMatched == 0 && printLevel_ >= 1)
+      std::cerr << "[EventWriter::book] "
+                << "branchCompression: no booked branch matches " << bc.first << std::endl;
+  }
+
+  for (auto& bs : branchBasketSizes_) {
+    unsigned nMatched(forEachMatchingBranch_(bs.first, [&bs](TBranch& branch) { branch.SetBasketSize(bs.second); }));
+
+    if (nMatched == 0 && printLevel_ >= 1)
+      std::cerr << "[EventWriter::book] "
+                << "branchBasketSize: no booked branch matches " << bs.first << std::endl;
+  }
+
+  basketSizesRestored_ = branchBasketSizes_.empty();
+}
+
+void
+EventWriter::restoreBasketSizes_()
+{
+  // TTree::OptimizeBaskets at the first flush resizes all branches; put the configured sizes back
+  for (auto& bs : branchBasketSizes_)
+    forEachMatchingBranch_(bs.first, [&bs](TBranch& branch) { branch.SetBasketSize(bs.second); });
+
+  basketSizesRestored_ = true;
+}
+
+void
+EventWriter::configureBranch_(TBranch& _branch)
+{
+  if (basketSize_ > 0)
+    _branch.SetBasketSize(basketSize_);
+
+  for (auto& bc : branchCompression_) {
+    if (matchesBranch_(bc.first, _branch.GetName()))
+      _branch.SetCompressionSettings(bc.second);
+  }
+
+  for (auto& bs : branchBasketSizes_) {
+    if (matchesBranch_(bs.first, _branch.GetName()))
+      _branch.SetBasketSize(bs.second);
+  }
+}
+
+unsigned
+EventWriter::forEachMatchingBranch_(std::string const& _name, std::function<void(TBranch&)> const& _apply)
+{
+  unsigned nMatched(0);
+  for (auto* obj : *eventTree_->GetListOfBranches()) {
+    auto* branch(static_cast<TBranch*>(obj));
+    if (matchesBranch_(_name, branch->GetName())) {
+      _apply(*branch);
+      ++nMatched;
+    }
+  }
+
+  return nMatched;
+}
+
+/*static*/
+bool
+EventWriter::matchesBranch_(std::string const& _name, std::string const& _branchName)
+{
+  return _branchName == _name || _branchName.compare(0, _name.size() + 1, _name + ".") == 0;
+}
+
+/*static*/
+int
+EventWriter::parseCompression_(std::string const& _spec)
+{
+  size_t colon(_spec.find(':'));
+  std::string algo(_spec.substr(0, colon));
+  int level(colon == std::string::npos ? -1 : std::atoi(_spec.c_str() + colon + 1));
+
+  if (level < 0 || level > 9)
+    throw edm::Exception(edm::errors::Configuration, "Invalid compression setting " + _spec + " (expected ALGORITHM:level with level 0-9)");
+
+  // ROOT compression settings are 100 * algorithm + level
+  if (algo == "ZLIB")
+    return 100 + level;
+  if (algo == "LZMA")
+    return 200 + level;
+  if (algo == "LZ4")
+    return 400 + level;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)
+  if (algo == "ZSTD")
+    return 500 + level;
+#endif
+
+  throw edm::Exception(edm::errors::Configuration, "Unsupported compression algorithm " + algo);
+}
+
+void
+EventWriter::countEvent(bool _selected)
+{
+  if (_selected)
+    ++nSelected_;
+  else
+    ++nAll_;
+}
+
+void
+EventWriter::fillEvent(suep::Event& _event)
+{
+  if (queueSize_ == 0) {
+    fillTree_(_event, streamExtensions_(_event));
+    return;
+  }
+
+  Buffer* buffer(0);
+  {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    // back-pressure: wait until the writer thread releases a buffer
+    freeCondition_.wait(lock, [this]() { return !freeBuffers_.empty() || writerError_; });
+
+    if (writerError_)
+      std::rethrow_exception(writerError_);
+
+    buffer = freeBuffers_.front();
+    freeBuffers_.pop_front();
+  }
+
+  buffer->event = _event;
+
+  auto& extensions(streamExtensions_(_event));
+  for (unsigned iX(0); iX != extensions.size(); ++iX)
+    buffer->extensions[iX]->copy(*extensions[iX]);
+
+  {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    queuedEvents_.push_back(buffer);
+  }
+  queuedCondition_.notify_one();
+}
+
+void
+EventWriter::fillTree_(suep::Event& _event, std::vector<EventExtension*> const& _extensions)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto start(std::chrono::steady_clock::now());
+
+  if (!bookedEvent_)
+    bookEventTree_();
+
+  if (bookedEvent_ != &_event) {
+    *bookedEvent_ = _event;
+    for (unsigned iX(0); iX != _extensions.size(); ++iX)
+      bookedExtensions_[iX]->copy(*_extensions[iX]);
+  }
+
+  if (genParamPending_) {
+    std::lock_guard<std::mutex> idsLock(genParamMutex_);
+    if (genParamIdsSet_)
+      bookGenParam_();
+  }
+
+  if (genParamPending_)
+    pendingGenParam_.insert(pendingGenParam_.end(), _event.genReweight.genParam, _event.genReweight.genParam + suep::GenReweight::NMAX);
+  else if (genParamBranch_)
+    std::copy_n(_event.genReweight.genParam, nGenParam_, genParam_);
+
+  for (auto* extension : bookedExtensions_)
+    extension->prepareFill(*eventTree_);
+
+  bookedEvent_->fill(*eventTree_);
+
+  if (!basketSizesRestored_ && eventTree_->GetFlushedBytes() != 0)
+    restoreBasketSizes_();
+
+  ++nEventsInFile_;
+
+  long long entry(eventTree_->GetEntries() - 1);
+  LumiEntries newLumi{entry, entry, {}};
+  auto inserted(lumiEntries_.emplace(std::make_pair(_event.runNumber, _event.lumiNumber), newLumi));
+  if (!inserted.second) {
+    auto& lumiEntries(inserted.first->second);
+    if (lumiEntries.entries.empty() && entry != lumiEntries.last + 1) {
+      // events of another lumi came in between (concurrent lumis); switch to an explicit list
+      for (long long e(lumiEntries.first); e <= lumiEntries.last; ++e)
+        lumiEntries.entries.push_back(e);
+    }
+    if (!lumiEntries.entries.empty())
+      lumiEntries.entries.push_back(entry);
+
+    lumiEntries.last = entry;
+  }
+
+  if (summaryTree_) {
+    summary_.set(*bookedEvent_);
+    summaryTree_->Fill();
+  }
+
+  if (printLevel_ >= 1 || recordTiming_) {
+    auto dt(std::chrono::steady_clock::now() - start);
+    outputTime_ += dt;
+    ++nOutputEvents_;
+    outputLatency_.fill(dt);
+  }
+}
+
+void
+EventWriter::writeLoop_()
+{
+  while (true) {
+    Buffer* buffer(0);
+    {
+      std::unique_lock<std::mutex> lock(queueMutex_);
+      queuedCondition_.wait(lock, [this]() { return !queuedEvents_.empty() || stopRequested_; });
+
+      if (queuedEvents_.empty()) // stop requested and all events written
+        return;
+
+      buffer = queuedEvents_.front();
+      queuedEvents_.pop_front();
+    }
+
+    try {
+      fillTree_(buffer->event, buffer->extensions);
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(queueMutex_);
+      writerError_ = std::current_exception();
+      freeCondition_.notify_all();
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(queueMutex_);
+      freeBuffers_.push_back(buffer);
+    }
+    freeCondition_.notify_one();
+  }
+}
+
+void
+EventWriter::stopWriter_()
+{
+  {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    stopRequested_ = true;
+  }
+  queuedCondition_.notify_one();
+
+  writerThread_.join();
+}
+
+void
+EventWriter::fillRun(suep::Run const& _run)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  fillRun_(_run);
+}
+
+void
+EventWriter::fillRun_(suep::Run const& _run)
+{
+  if (!writtenRuns_.insert(_run.runNumber).second)
+    return;
+
+  outEvent_.run = _run;
+  outEvent_.run.fill(*runTree_);
+}
+
+void
+EventWriter::setCurrentRun(suep::Run const& _run)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  currentRun_ = _run;
+}
+
+void
+EventWriter::addRolloverClient(RolloverCallback const& _beforeClose, RolloverCallback const& _afterOpen)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  rolloverClients_.emplace_back(_beforeClose, _afterOpen);
+}
+
+bool
+EventWriter::rolloverIfDue()
+{
+  if (maxEventsPerFile_ == 0 && maxFileSize_ == 0)
+    return false;
+
+  // the events of the closing lumi go to the current file
+  waitForQueue_();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (nEventsInFile_ == 0)
+    return false;
+
+  if ((maxEventsPerFile_ == 0 || nEventsInFile_ < maxEventsPerFile_) &&
+      (maxFileSize_ == 0 || outputFile_->GetBytesWritten() < maxFileSize_))
+    return false;
+
+  if (printLevel_ >= 1)
+    std::cout << "[EventWriter::rolloverIfDue] "
+              << "Closing " << outputFile_->GetName() << " after " << nEventsInFile_ << " events" << std::endl;
+
+  for (auto& client : rolloverClients_)
+    client.first(*outputFile_);
+
+  // the run in progress also needs an entry in this file
+  if (currentRun_.runNumber != 0)
+    fillRun_(currentRun_);
+
+  closeFile_();
+
+  writtenRuns_.clear();
+  ++fileIndex_;
+
+  openFile_();
+
+  for (auto& client : rolloverClients_)
+    client.second(*outputFile_);
+
+  return true;
+}
+
+void
+EventWriter::waitForQueue_()
+{
+  if (queueSize_ == 0)
+    return;
+
+  std::unique_lock<std::mutex> lock(queueMutex_);
+  freeCondition_.wait(lock, [this]() { return freeBuffers_.size() == buffers_.size() || writerError_; });
+
+  if (writerError_)
+    std::rethrow_exception(writerError_);
+}
+
+void
+EventWriter::fillLumiSummary(unsigned _run, unsigned _lumi, unsigned _nEvents)
+{
+  // entry ranges are known only after the writer thread has filled all events of the lumi
+  waitForQueue_();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  lumiRunNumber_ = _run;
+  lumiNumber_ = _lumi;
+  nEventsInLumi_ = _nEvents;
+
+  auto itr(lumiEntries_.find(std::make_pair(_run, _lumi)));
+  if (itr == lumiEntries_.end()) {
+    lumiFirstEntry_ = -1;
+    lumiLastEntry_ = -1;
+    lumiEntryList_.clear();
+  }
+  else {
+    lumiFirstEntry_ = itr->second.first;
+    lumiLastEntry_ = itr->second.last;
+    lumiEntryList_.swap(itr->second.entries);
+    lumiEntries_.erase(itr);
+  }
+
+  lumiSummaryTree_->Fill();
+}
+
+void
+EventWriter::mergeStreamOutput(TDirectory& _scratch)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  mergeStreamOutput_(_scratch);
+}
+
+void
+EventWriter::mergeStreamOutput_(TDirectory& _scratch)
+{
+  for (auto* obj : *_scratch.GetList()) {
+    auto* source(dynamic_cast<TH1*>(obj));
+    if (!source)
+      continue;
+
+    auto* target(dynamic_cast<TH1*>(outputFile_->Get(source->GetName())));
+    if (!target) {
+      std::cerr << "[EventWriter::mergeStreamOutput] "
+                << "Histogram " << source->GetName() << " has no counterpart in the output file" << std::endl;
+      continue;
+    }
+
+    addHistogram(*target, *source);
+  }
+}
+
+/*static*/
+void
+EventWriter::addHistogram(TH1& _target, TH1 const& _source)
+{
+  int nTarget(_target.GetNbinsX());
+  int nSource(_source.GetNbinsX());
+
+  if (nSource == nTarget || _target.GetDimension() != 1) {
+    _target.Add(&_source);
+    return;
+  }
+
+  double entries(_target.GetEntries() + _source.GetEntries());
+
+  if (_target.GetSumw2N() == 0 && _source.GetSumw2N() != 0)
+    _target.Sumw2();
+
+  if (nSource > nTarget) {
+    // the old overflow becomes bin nTarget + 1
+    double overflow(_target.GetBinContent(nTarget + 1));
+    double overflowError(_target.GetBinError(nTarget + 1));
+
+    _target.SetBins(nSource, _source.GetXaxis()->GetXmin(), _source.GetXaxis()->GetXmax());
+    for (int iB(nTarget + 1); iB <= nSource; ++iB) {
+      _target.SetBinContent(iB, 0.);
+      _target.SetBinError(iB, 0.);
+      _target.GetXaxis()->SetBinLabel(iB, _source.GetXaxis()->GetBinLabel(iB));
+    }
+    _target.SetBinContent(nSource + 1, overflow);
+    _target.SetBinError(nSource + 1, overflowError);
+  }
+
+  bool sumw2(_target.GetSumw2N() != 0);
+  int nBins(_target.GetNbinsX());
+  for (int iB(0); iB <= nSource + 1; ++iB) {
+    // overflow to overflow
+    int iT(iB == nSource + 1 ? nBins + 1 : iB);
+    double error(std::hypot(_target.GetBinError(iT), _source.GetBinError(iB)));
+    _target.SetBinContent(iT, _target.GetBinContent(iT) + _source.GetBinContent(iB));
+    if (sumw2)
+      _target.SetBinError(iT, error);
+  }
+
+  _target.SetEntries(entries);
+}
+
+void
+EventWriter::copyAuxiliaryObjects(EventWriter& _source)
+{
+  std::lock_guard<std::mutex> sourceLock(_source.mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  TDirectory::TContext context(outputFile_);
+
+  for (auto* obj : *_source.outputFile_->GetList()) {
+    if (obj == _source.eventTree_ || obj == _source.runTree_ || obj == _source.lumiSummaryTree_ || obj == _source.eventCounter_ || obj == _source.summaryTree_ || obj == _source.weightsTree_)
+      continue;
+
+    if (outputFile_->GetList()->FindObject(obj->GetName())) {
+      std::cerr << "[EventWriter::copyAuxiliaryObjects] "
+                << "Object " << obj->GetName() << " already exists in " << outputFile_->GetName() << std::endl;
+      continue;
+    }
+
+    if (auto* hist = dynamic_cast<TH1*>(obj)) {
+      auto* clone(static_cast<TH1*>(hist->Clone()));
+      clone->SetDirectory(outputFile_);
+    }
+    else if (auto* tree = dynamic_cast<TTree*>(obj)) {
+      // clone is created in the current directory
+      tree->CloneTree(-1);
+    }
+  }
+}
+
+void
+EventWriter::addTimers(std::vector<std::string> const& _names, std::vector<Duration> const& _timers, unsigned long long _nEvents)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (timers_.empty()) {
+    timerNames_ = _names;
+    timers_.assign(_timers.size(), Duration::zero());
+  }
+
+  for (unsigned iT(0); iT != _timers.size() && iT != timers_.size(); ++iT)
+    timers_[iT] += _timers[iT];
+
+  nTimedEvents_ += _nEvents;
+  if (_nEvents > 1)
+    nOtherEvents_ += _nEvents - 1;
+}
+
+void
+EventWriter::addLatencies(std::vector<std::pair<std::string, std::string>> const& _labels, std::vector<LatencyHistogram> const& _latencies)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (latencies_.empty()) {
+    latencyLabels_ = _labels;
+    latencies_.resize(_latencies.size());
+  }
+
+  for (unsigned iL(0); iL != _latencies.size() && iL != latencies_.size(); ++iL)
+    latencies_[iL].add(_latencies[iL]);
+}
+
+void
+EventWriter::addAllocations(std::vector<std::pair<std::string, std::string>> const& _labels, std::vector<AllocationCounter::Counts> const& _allocations)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (allocations_.empty()) {
+    allocationLabels_ = _labels;
+    allocations_.resize(_allocations.size());
+  }
+
+  for (unsigned iA(0); iA != _allocations.size() && iA != allocations_.size(); ++iA)
+    allocations_[iA].add(_allocations[iA]);
+}
+
+void
+EventWriter::writeLatencies_()
+{
+  // called from close() with the mutex locked
+  auto* dir(outputFile_->mkdir("timing"));
+  TDirectory::TContext context(dir);
+
+  TString name;
+  TString phase;
+  unsigned long long n(0);
+  double mean(0.);
+  double p50(0.);
+  double p90(0.);
+  double p99(0.);
+  double max(0.);
+
+  auto* summary(new TTree("summary", "Latency percentiles in ms"));
+  summary->Branch("name", "TString", &name);
+  summary->Branch("phase", "TString", &phase);
+  summary->Branch("n", &n, "n/l");
+  summary->Branch("mean", &mean, "mean/D");
+  summary->Branch("p50", &p50, "p50/D");
+  summary->Branch("p90", &p90, "p90/D");
+  summary->Branch("p99", &p99, "p99/D");
+  summary->Branch("max", &max, "max/D");
+
+  auto fillOne([&](LatencyHistogram const& _hist) {
+      if (_hist.getCount() == 0)
+        return;
+
+      _hist.makeTH1(name + "_" + phase, name + " " + phase + ";t (ms)")->SetDirectory(dir);
+
+      n = _hist.getCount();
+      mean = _hist.getMean();
+      p50 = _hist.getQuantile(0.5);
+      p90 = _hist.getQuantile(0.9);
+      p99 = _hist.getQuantile(0.99);
+      max = _hist.getMax();
+      summary->Fill();
+    });
+
+  for (unsigned iL(0); iL != latencies_.size(); ++iL) {
+    name = latencyLabels_[iL].first;
+    phase = latencyLabels_[iL].second;
+    fillOne(latencies_[iL]);
+  }
+
+  name = "output";
+  phase = "fillTree";
+  fillOne(outputLatency_);
+}
+
+void
+EventWriter::printTimers_() const
+{
+  if (timers_.empty() || nTimedEvents_ == 0)
+    return;
+
+  double total(0.);
+
+  std::cout << "[SUEPProducer::endJob] Timer summary" << std::endl;
+  for (unsigned iF(0); iF != timerNames_.size(); ++iF) {
+    double msPerEvt(toMS(timers_[iF]) / nTimedEvents_);
+    std::cout << " " << timerNames_[iF] << "  "
+              << std::fixed << std::setprecision(3) << msPerEvt << " ms/evt"
+              << std::endl;
+
+    total += msPerEvt;
+  }
+  if (nOtherEvents_ != 0) {
+    double msPerEvt(toMS(timers_.back()) / nOtherEvents_);
+    std::cout << " Other CMSSW  "
+              << std::fixed << std::setprecision(3) << msPerEvt << " ms/evt"
+              << std::endl;
+
+    total += msPerEvt;
+  }
+  std::cout << std::endl << " Total  "
+            << std::fixed << std::setprecision(3) << total << " ms/evt"
+            << std::endl;
+
+  if (nOutputEvents_ != 0) {
+    std::cout << " Output" << (queueSize_ == 0 ? "  " : " (writer thread)  ")
+              << std::fixed << std::setprecision(3) << toMS(outputTime_) / nOutputEvents_ << " ms/evt"
+              << std::endl;
+  }
+}
+
+void
+EventWriter::printAllocations_() const
+{
+  std::cout << "[SUEPProducer::endJob] Allocation summary" << std::endl;
+  for (unsigned iA(0); iA != allocations_.size(); ++iA) {
+    auto& counts(allocations_[iA]);
+    if (counts.nAllocations == 0)
+      continue;
+
+    // fill and setRefs run only on the selected events; normalize to the events the step ran on
+    std::cout << " " << allocationLabels_[iA].first << "::" << allocationLabels_[iA].second << "  "
+              << std::fixed << std::setprecision(1) << double(counts.nAllocations) / counts.nScopes << " allocs/evt  "
+              << std::fixed << std::setprecision(1) << counts.nBytes / 1024. / counts.nScopes << " kB/evt"
+              << std::endl;
+  }
+}
+
+void
+EventWriter::recordBranchSizes_()
+{
+  // called from closeFile_() with the mutex locked
+  eventTree_->FlushBaskets();
+
+  // collections are split into top-level branches "name.field"
+  std::map<std::string, std::tuple<std::string, long long, long long>> fileSizes;
+  for (auto* obj : *eventTree_->GetListOfBranches()) {
+    auto* branch(static_cast<TBranch*>(obj));
+    std::string name(branch->GetName());
+    name = name.substr(0, name.find('.'));
+
+    auto inserted(fileSizes.emplace(name, std::make_tuple(std::string("SUEPProducer"), 0LL, 0LL)));
+    auto& entry(inserted.first->second);
+    if (inserted.second) {
+      suep::utils::BranchName bname(name);
+      for (auto& owner : branchOwners_) {
+        if (bname.in(owner.second)) {
+          std::get<0>(entry) = owner.first;
+          break;
+        }
+      }
+    }
+
+    std::get<1>(entry) += branch->GetZipBytes("*");
+    std::get<2>(entry) += branch->GetTotBytes("*");
+  }
+
+  TDirectory::TContext context(outputFile_);
+
+  TString name;
+  TString filler;
+  long long zipBytes(0);
+  long long totBytes(0);
+  double bytesPerEvent(0.);
+  double ratio(0.);
+
+  auto* tree(new TTree("branchSizes", "Events tree size per collection"));
+  tree->Branch("name", "TString", &name);
+  tree->Branch("filler", "TString", &filler);
+  tree->Branch("zipBytes", &zipBytes, "zipBytes/L");
+  tree->Branch("totBytes", &totBytes, "totBytes/L");
+  tree->Branch("bytesPerEvent", &bytesPerEvent, "bytesPerEvent/D");
+  tree->Branch("ratio", &ratio, "ratio/D");
+
+  long long nEntries(eventTree_->GetEntries());
+
+  for (auto& fs : fileSizes) {
+    name = fs.first;
+    filler = std::get<0>(fs.second);
+    zipBytes = std::get<1>(fs.second);
+    totBytes = std::get<2>(fs.second);
+    bytesPerEvent = nEntries == 0 ? 0. : double(zipBytes) / nEntries;
+    ratio = zipBytes == 0 ? 0. : double(totBytes) / zipBytes;
+    tree->Fill();
+
+    auto inserted(branchSizes_.emplace(fs.first, fs.second));
+    if (!inserted.second) {
+      std::get<1>(inserted.first->second) += zipBytes;
+      std::get<2>(inserted.first->second) += totBytes;
+    }
+  }
+
+  nBranchSizeEvents_ += nEntries;
+}
+
+void
+EventWriter::printBranchSizes_() const
+{
+  if (branchSizes_.empty())
+    return;
+
+  // filler -> (compressed, uncompressed)
+  std::map<std::string, std::pair<long long, long long>> fillerSizes;
+  long long zipTotal(0);
+  for (auto& bs : branchSizes_) {
+    auto& sizes(fillerSizes[std::get<0>(bs.second)]);
+    sizes.first += std::get<1>(bs.second);
+    sizes.second += std::get<2>(bs.second);
+    zipTotal += std::get<1>(bs.second);
+  }
+
+  double nEvents(nBranchSizeEvents_ == 0 ? 1. : nBranchSizeEvents_);
+
+  auto printLine([&](std::string const& _indent, std::string const& _name, long long _zip, long long _tot) {
+      std::cout << _indent << _name << "  "
+                << std::fixed << std::setprecision(1) << _zip / nEvents << " B/evt  "
+                << std::setprecision(1) << (zipTotal == 0 ? 0. : 100. * _zip / zipTotal) << "%  "
+                << "ratio " << std::setprecision(2) << (_zip == 0 ? 0. : double(_tot) / _zip)
+                << std::endl;
+    });
+
+  std::cout << "[SUEPProducer::endJob] Branch size summary (" << outputName_ << ", " << nBranchSizeEvents_ << " events)" << std::endl;
+  for (auto& fs : fillerSizes) {
+    printLine(" ", fs.first, fs.second.first, fs.second.second);
+    for (auto& bs : branchSizes_) {
+      if (std::get<0>(bs.second) == fs.first)
+        printLine("   ", bs.first, std::get<1>(bs.second), std::get<2>(bs.second));
+    }
+  }
+}
@@ -4,6 +4,7 @@
 #include "DataFormats/JetReco/interface/GenJet.h"
 #include "DataFormats/Math/interface/deltaR.h"
 
+#include <algorithm>
 #include <functional>
 
 FatJetsFiller::FatJetsFiller(std::string const& _name, edm::ParameterSet const& _cfg, edm::ConsumesCollector& _coll) :
@@ -20,7 +21,8 @@ FatJetsFiller::FatJetsFiller(std::string const& _name, edm::ParameterSet const&
   subjetDeepCsvTag_(getParameter_<std::string>(_cfg, "subjetDeepCSV", "")),
   subjetDeepCmvaTag_(getParameter_<std::string>(_cfg, "subjetDeepCMVA", "")),
   activeArea_(7., 1, 0.01),
-  areaDef_(fastjet::active_area_explicit_ghosts, activeArea_)
+  areaDef_(fastjet::active_area_explicit_ghosts, activeArea_),
+  subjetMatcher_(R_)
 {
   if (_name == "puppiAK8Jets")
     outSubjetSelector_ = [](suep::Event& _event)->suep::MicroJetCollection& { return _event.puppiAK8Subjets; };
@@ -102,6 +104,34 @@ FatJetsFiller::branchNames(suep::utils::BranchList& _eventBranches, suep::utils:
   }
 }
 
+void
+FatJetsFiller::setBookedBranches(suep::utils::BranchList const& _eventBranches, suep::utils::BranchList const& _runBranches)
+{
+  JetsFiller::setBookedBranches(_eventBranches, _runBranches);
+
+  TString subjetName(getName());
+  subjetName.ReplaceAll("Jets", "Subjets");
+  fillSubjets_ = isBooked_(_eventBranches, subjetName.Data());
+
+  if (computeSubstructure_ != kNever) {
+    char const* substrBranches[] = {
+      ".tau1SD",
+      ".tau2SD",
+      ".tau3SD",
+      ".htt_mass",
+      ".htt_frec",
+      ".ecfs"
+    };
+    bool booked(false);
+    for (char const* b : substrBranches)
+      booked = booked || isBooked_(_eventBranches, getName() + b);
+
+    // ECFs, groomed tauN and HTT are the most expensive part of the filler
+    if (!booked)
+      computeSubstructure_ = kNever;
+  }
+}
+
 void
 FatJetsFiller::fillDetails_(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventSetup const& _setup)
 {
@@ -114,15 +144,25 @@ FatJetsFiller::fillDetails_(suep::Event& _outEvent, edm::Event const& _inEvent,
 
   typedef std::vector<fastjet::PseudoJet> VPseudoJet;
 
-  auto& jetMap(objectMap_->get<reco::Jet, suep::Jet>());
+  auto& jetMap(*jetMap_);
+
+  if (fillSubjets_) {
+    subjetMatcher_.clear();
+    subjetMatcher_.reserve(inSubjets.size());
+    for (auto& inSubjet : inSubjets)
+      subjetMatcher_.addTarget(inSubjet.eta(), inSubjet.phi());
+    subjetMatcher_.build();
+  }
+
+  ScratchVector<unsigned> subjetIndices(getArena_());
 
   unsigned iJ(0);
 
-  for (auto& link : jetMap.bwdMap) { // suep -> edm
-    auto& outJet(static_cast<suep::FatJet&>(*link.first));
+  for (auto& link : jetMap) { // suep -> edm
+    auto& outJet(static_cast<suep::FatJet&>(*link.suepObj));
 
-    if (dynamic_cast<pat::Jet const*>(link.second.get())) {
-      auto& inJet(static_cast<pat::Jet const&>(*link.second));
+    if (dynamic_cast<pat::Jet const*>(link.edmPtr.get())) {
+      auto& inJet(static_cast<pat::Jet const&>(*link.edmPtr));
 
       outJet.tau1 = inJet.userFloat(njettinessTag_ + ":tau1");
       outJet.tau2 = inJet.userFloat(njettinessTag_ + ":tau2");
@@ -137,38 +177,44 @@ FatJetsFiller::fillDetails_(suep::Event& _outEvent, edm::Event const& _inEvent,
       if (!deepBBprobHTag_.empty())
         outJet.deepBBprobH = inJet.bDiscriminator(deepBBprobHTag_);
 
-      for (auto& inSubjet : inSubjets) {
-        if (reco::deltaR(inSubjet.eta(), inSubjet.phi(), inJet.eta(), inJet.phi()) > R_) 
-          continue;
+      if (fillSubjets_) {
+        // subjets within R of the jet axis, in input order
+        subjetIndices.clear();
+        subjetMatcher_.forEachInCone(inJet.eta(), inJet.phi(), R_, [&subjetIndices](unsigned _iS, double) { subjetIndices.push_back(_iS); });
+        std::sort(subjetIndices.begin(), subjetIndices.end());
+
+        for (unsigned iS : subjetIndices) {
+          auto& inSubjet(inSubjets.at(iS));
 
-        auto& outSubjet(outSubjets.create_back());
+          auto& outSubjet(outSubjets.create_back());
 
-        fillP4(outSubjet, inSubjet);
+          fillP4(outSubjet, inSubjet);
 
-        if (dynamic_cast<pat::Jet const*>(&inSubjet)) {
-          auto& patSubjet(dynamic_cast<pat::Jet const&>(inSubjet));
-          if (!subjetBtagTag_.empty())
-            outSubjet.csv = patSubjet.bDiscriminator(subjetBtagTag_);
-          if (!subjetCmvaTag_.empty())
-            outSubjet.cmva = patSubjet.bDiscriminator(subjetCmvaTag_);
-          if (!subjetQGLTag_.empty() && patSubjet.hasUserFloat(subjetQGLTag_))
-            outSubjet.qgl = patSubjet.userFloat(subjetQGLTag_);
+          if (dynamic_cast<pat::Jet const*>(&inSubjet)) {
+            auto& patSubjet(dynamic_cast<pat::Jet const&>(inSubjet));
+            if (!subjetBtagTag_.empty())
+              outSubjet.csv = patSubjet.bDiscriminator(subjetBtagTag_);
+            if (!subjetCmvaTag_.empty())
+              outSubjet.cmva = patSubjet.bDiscriminator(subjetCmvaTag_);
+            if (!subjetQGLTag_.empty() && patSubjet.hasUserFloat(subjetQGLTag_))
+              outSubjet.qgl = patSubjet.userFloat(subjetQGLTag_);
 
-          if (!subjetDeepCsvTag_.empty()) {
-            for (auto prob : deepProbs) {
-              fillDeepBySwitch_(outSubjet, prob.second, patSubjet.bDiscriminator(subjetDeepCsvTag_ + ":prob" + prob.first));
+            if (!subjetDeepCsvTag_.empty()) {
+              for (auto prob : deepProbs) {
+                fillDeepBySwitch_(outSubjet, prob.second, patSubjet.bDiscriminator(subjetDeepCsvTag_ + ":prob" + prob.first));
+              }
             }
-          }
 
-          if (!subjetDeepCmvaTag_.empty()) {
-            for (auto prob : deepProbs) {
-              fillDeepBySwitch_(outSubjet, prob.second + deepSuff::DEEP_SIZE, patSubjet.bDiscriminator(subjetDeepCmvaTag_ + ":prob" + prob.first));
+            if (!subjetDeepCmvaTag_.empty()) {
+              for (auto prob : deepProbs) {
+                fillDeepBySwitch_(outSubjet, prob.second + deepSuff::DEEP_SIZE, patSubjet.bDiscriminator(subjetDeepCmvaTag_ + ":prob" + prob.first));
+              }
             }
+
           }
 
+          outJet.subjets.addRef(&outSubjet);
         }
-
-        outJet.subjets.addRef(&outSubjet);
       }
 
       // reset the ECFs
@@ -186,17 +232,17 @@ FatJetsFiller::fillDetails_(suep::Event& _outEvent, edm::Event const& _inEvent,
         // only filled for first two fat jets
 
         // calculate ECFs, groomed tauN
-        VPseudoJet vjet;
+        constituents_.clear();
         for (auto&& ptr : inJet.getJetConstituents()) { 
           // create vector of PseudoJets
           auto& cand(*ptr);
           if (cand.pt() < 0.01) 
             continue;
 
-          vjet.emplace_back(cand.px(), cand.py(), cand.pz(), cand.energy());
+          constituents_.emplace_back(cand.px(), cand.py(), cand.pz(), cand.energy());
         }
 
-        fastjet::ClusterSequenceArea seq(vjet, *jetDefCA_, areaDef_);
+        fastjet::ClusterSequenceArea seq(constituents_, *jetDefCA_, areaDef_);
         VPseudoJet alljets(fastjet::sorted_by_pt(seq.inclusive_jets(0.1)));
 
         if (alljets.size() > 0){
@@ -3,11 +3,37 @@
 FillerBase::FillerBase(std::string const& _fillerName, edm::ParameterSet const& _cfg) :
   fillerName_(_fillerName),
   enabled_(getParameter_<bool>(_cfg, "enabled")),
+  arenaSize_(getParameter_<unsigned>(_cfg, "arenaSize", 256) * 1024),
+  arenaBuffer_(new char[arenaSize_]),
+  arena_(arenaBuffer_.get(), arenaSize_),
   isRealData_(getGlobalParameter_<bool>(_cfg, "isRealData")),
   useTrigger_(getGlobalParameter_<bool>(_cfg, "useTrigger"))
 {
 }
 
+void
+FillerBase::resolveObjectMaps(ObjectMapStore& _store)
+{
+  for (auto& resolver : mapResolvers_)
+    resolver(_store);
+}
+
+/*static*/
+bool
+FillerBase::isBooked_(suep::utils::BranchList const& _list, std::string const& _branchName)
+{
+  return suep::utils::BranchName(_branchName).in(_list);
+}
+
+std::unique_lock<std::mutex>
+FillerBase::lockFramework_() const
+{
+  if (frameworkMutex_)
+    return std::unique_lock<std::mutex>(*frameworkMutex_);
+  else
+    return std::unique_lock<std::mutex>();
+}
+
 void
 fillP4(suep::Particle& _out, reco::Candidate const& _in)
 {
@@ -0,0 +1,85 @@
+#include "../interface/FillerGraph.h"
+
+#include "FWCore/Utilities/interface/EDMException.h"
+
+#include <map>
+
+FillerGraph::FillerGraph(std::vector<FillerBase*> const& _fillers, Step const& _fill, Step const& _setRefs) :
+  graph_(),
+  start_(graph_)
+{
+  std::map<std::string, unsigned> indices;
+  for (unsigned iF(0); iF != _fillers.size(); ++iF)
+    indices[_fillers[iF]->getName()] = iF;
+
+  // check for circular setRefs dependencies - they would leave the nodes waiting forever
+  std::vector<int> state(_fillers.size(), 0); // 0: unvisited, 1: in the current path, 2: done
+  std::function<void(unsigned)> visit([&](unsigned iF) {
+      state[iF] = 1;
+      for (auto& name : _fillers[iF]->getRefDependencies()) {
+        auto itr(indices.find(name));
+        if (itr == indices.end() || itr->second == iF)
+          continue;
+
+        if (state[itr->second] == 1)
+          throw edm::Exception(edm::errors::Configuration, "Circular setRefs dependency between " + _fillers[iF]->getName() + " and " + name);
+        if (state[itr->second] == 0)
+          visit(itr->second);
+      }
+      state[iF] = 2;
+    });
+
+  for (unsigned iF(0); iF != _fillers.size(); ++iF) {
+    if (state[iF] == 0)
+      visit(iF);
+  }
+
+  for (unsigned iF(0); iF != _fillers.size(); ++iF) {
+    fillNodes_.emplace_back(new Node(graph_, [_fill, iF](tbb::flow::continue_msg const&) { _fill(iF); }));
+    refNodes_.emplace_back(new Node(graph_, [_setRefs, iF](tbb::flow::continue_msg const&) { _setRefs(iF); }));
+  }
+
+  std::map<std::string, unsigned> lastResourceUser;
+
+  for (unsigned iF(0); iF != _fillers.size(); ++iF) {
+    auto& filler(*_fillers[iF]);
+
+    bool serialized(false);
+    for (auto& resource : filler.getSharedResources()) {
+      auto itr(lastResourceUser.find(resource));
+      if (itr != lastResourceUser.end()) {
+        tbb::flow::make_edge(*fillNodes_[itr->second], *fillNodes_[iF]);
+        serialized = true;
+      }
+      lastResourceUser[resource] = iF;
+    }
+
+    if (!serialized)
+      tbb::flow::make_edge(start_, *fillNodes_[iF]);
+
+    tbb::flow::make_edge(*fillNodes_[iF], *refNodes_[iF]);
+
+    for (auto& name : filler.getRefDependencies()) {
+      auto itr(indices.find(name));
+      if (itr == indices.end() || itr->second == iF)
+        continue;
+
+      tbb::flow::make_edge(*refNodes_[itr->second], *refNodes_[iF]);
+    }
+  }
+}
+
+void
+FillerGraph::run()
+{
+  start_.try_put(tbb::flow::continue_msg());
+
+  try {
+    graph_.wait_for_all();
+  }
+  catch (...) {
+    // nodes are left half-triggered by the cancelled execution
+    graph_.reset();
+    throw;
+  }
+}
@@ -41,6 +41,9 @@ GenJetsFiller::GenJetsFiller(std::string const& _name, edm::ParameterSet const&
     outputSelector_ = [](suep::Event& _event)->suep::GenJetCollection& { return _event.ca15GenJets; };
   else
     throw edm::Exception(edm::errors::Configuration, "Unknown GenJetCollection output");    
+
+  registerObjectMap_(genJetMap_);
+  consumesObjectMap_(genParticleMap_, "genParticles");
 }
 
 void
@@ -160,7 +163,7 @@ GenJetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
   auto originalIndices(outJets.sort(suep::Particle::PtGreater));
 
   // make reco <-> suep mapping
-  auto& objectMap(objectMap_->get<reco::GenJet, suep::GenJet>());
+  auto& objectMap(*genJetMap_);
   
   for (unsigned iP(0); iP != outJets.size(); ++iP) {
     auto& outJet(outJets[iP]);
@@ -170,23 +173,22 @@ GenJetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
 }
 
 void
-GenJetsFiller::setRefs(ObjectMapStore const& _objectMaps)
+GenJetsFiller::setRefs(ObjectMapStore const&)
 {
-  auto& genJetMap(objectMap_->get<reco::GenJet, suep::GenJet>().fwdMap);
-  auto& genParticleMap(_objectMaps.at("genParticles").get<reco::Candidate, suep::GenParticle>().fwdMap);
+  auto& genJetMap(*genJetMap_);
+  auto& genParticleMap(*genParticleMap_);
   // For each gen jet
   if (jetBHadrons_.size()>0) {
     for (auto const& jetBHadronMapping : jetBHadrons_) {
       // Dig up the corresponding reference to the suep::GenJet
       auto& matchedJetPtr(jetBHadronMapping.first);
-      auto&& genJetLink(genJetMap.find(matchedJetPtr));
-      auto& outGenJet(*genJetLink->second);
+      auto& outGenJet(*genJetMap.at(matchedJetPtr));
 
       std::vector<reco::CandidatePtr> const& matchedBHadrons(jetBHadronMapping.second);
       for (unsigned iHad=0; iHad < matchedBHadrons.size(); iHad++) {
-        auto&& outGenParticleLink(genParticleMap.find(matchedBHadrons.at(iHad)));
-        if(outGenParticleLink != genParticleMap.end())
-          outGenJet.matchedBHadrons.addRef(outGenParticleLink->second);
+        auto* outGenParticle(genParticleMap.find(matchedBHadrons.at(iHad)));
+        if(outGenParticle)
+          outGenJet.matchedBHadrons.addRef(outGenParticle);
         else
           edm::LogWarning("GenJetsFiller") << "Could not add reference to gen particle (iHad="<<iHad<<") looking in map with size "<<genParticleMap.size()<<"\n";
       }
@@ -197,14 +199,13 @@ GenJetsFiller::setRefs(ObjectMapStore const& _objectMaps)
     for (auto const& jetCHadronMapping : jetCHadrons_) {
       // Dig up the corresponding reference to the suep::GenJet
       auto& matchedJetPtr(jetCHadronMapping.first);
-      auto&& genJetLink(genJetMap.find(matchedJetPtr));
-      auto &outGenJet(*genJetLink->second);
+      auto& outGenJet(*genJetMap.at(matchedJetPtr));
 
       std::vector<reco::CandidatePtr> const& matchedCHadrons(jetCHadronMapping.second);
       for (unsigned iHad=0; iHad<matchedCHadrons.size(); iHad++) {
-        auto&& outGenParticleLink(genParticleMap.find(matchedCHadrons.at(iHad)));
-        if(outGenParticleLink != genParticleMap.end())
-          outGenJet.matchedCHadrons.addRef(outGenParticleLink->second);
+        auto* outGenParticle(genParticleMap.find(matchedCHadrons.at(iHad)));
+        if(outGenParticle)
+          outGenJet.matchedCHadrons.addRef(outGenParticle);
         else
           edm::LogWarning("GenJetsFiller") << "Could not add reference to gen particle (iHad="<<iHad<<") looking in map with size "<<genParticleMap.size()<<"\n";
       }
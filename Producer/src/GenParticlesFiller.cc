@@ -11,19 +11,19 @@
 typedef edm::Ptr<reco::GenParticle> GenParticlePtr;
 typedef edm::Ptr<pat::PackedGenParticle> PackedGenParticlePtr;
 
-namespace {
-  // Track the PNodeWithPtrs that are made from packed collections
-  std::unordered_set<const void*> miniaodPacked;
-}
+struct PNodeWithPtr;
+typedef boost::container::pmr::map<reco::CandidatePtr, PNodeWithPtr*> NodeMap;
 
+//! Nodes are allocated from the memory resource of the node map and are destroyed (but not freed) after use
 struct PNodeWithPtr : public PNode {
   reco::CandidatePtr candPtr{};
   reco::CandidatePtr replacedCandPtr{};
   uint16_t packedPt{0xffff};
   uint16_t packedPhi{0xffff};
   uint16_t packedM{0xffff};
+  bool miniaodPacked{false}; // node is made from the packed collection
 
-  PNodeWithPtr(GenParticlePtr const& _ptr, std::map<reco::CandidatePtr, PNodeWithPtr*>& _nodeMap, PNode* _mother = 0) {
+  PNodeWithPtr(GenParticlePtr const& _ptr, NodeMap& _nodeMap, PNode* _mother = 0) {
     auto& inCand(*_ptr);
     pdgId = inCand.pdgId();
     status = inCand.status();
@@ -90,11 +90,11 @@ struct PNodeWithPtr : public PNode {
         }
       }
       else
-        daughters.push_back(new PNodeWithPtr(dptr, _nodeMap, this));
+        daughters.push_back(make(dptr, _nodeMap, this));
     }
   }
 
-  PNodeWithPtr(PackedGenParticlePtr const& _ptr, std::map<reco::CandidatePtr, PNodeWithPtr*>& _nodeMap) {
+  PNodeWithPtr(PackedGenParticlePtr const& _ptr, NodeMap& _nodeMap) {
     auto& inCand(*_ptr);
     pdgId = inCand.pdgId();
     status = 1;
@@ -108,6 +108,8 @@ struct PNodeWithPtr : public PNode {
     packedPhi = exposer.packedPhi();
     packedM = exposer.packedM();
 
+    miniaodPacked = true;
+
     candPtr = _ptr;
     // don't really need to add this to nodeMap, but makes it easy to delete the nodes later
     _nodeMap[candPtr] = this;
@@ -136,7 +138,7 @@ struct PNodeWithPtr : public PNode {
               statusBits = genP->statusFlags().flags_;
           }
 
-          delete d;
+          static_cast<PNodeWithPtr*>(d)->~PNodeWithPtr();
           _nodeMap.erase(replacedCandPtr);
           break;
         }
@@ -149,6 +151,12 @@ struct PNodeWithPtr : public PNode {
     }
   }
 
+  template<class Ptr, class... Args>
+  static PNodeWithPtr* make(Ptr const& _ptr, NodeMap& _nodeMap, Args... _args) {
+    void* mem(_nodeMap.get_allocator().resource()->allocate(sizeof(PNodeWithPtr), alignof(PNodeWithPtr)));
+    return new (mem) PNodeWithPtr(_ptr, _nodeMap, _args...);
+  }
+
   void fillSUEP(suep::GenParticleCollection& _outParticles, ObjectMap<reco::Candidate, suep::GenParticle>& _map, int parentIdx = -1) const {
     auto& outParticle(_outParticles.create_back());
     int myidx(_outParticles.size() - 1);
@@ -165,7 +173,7 @@ struct PNodeWithPtr : public PNode {
 
     outParticle.pdgid = pdgId;
     outParticle.finalState = (status == 1);
-    outParticle.miniaodPacked = (miniaodPacked.find(this) != miniaodPacked.end());
+    outParticle.miniaodPacked = miniaodPacked;
     outParticle.statusFlags = statusBits.to_ulong();
     outParticle.parent.idx() = parentIdx;
 
@@ -186,7 +194,7 @@ struct PNodeWithPtr : public PNode {
 
     outParticle.pdgid = pdgId;
     outParticle.finalState = (status == 1);
-    outParticle.miniaodPacked = (miniaodPacked.find(this) != miniaodPacked.end());
+    outParticle.miniaodPacked = miniaodPacked;
     outParticle.statusFlags = statusBits.to_ulong();
     outParticle.parent.idx() = parentIdx;
 
@@ -236,6 +244,8 @@ GenParticlesFiller::GenParticlesFiller(std::string const& _name, edm::ParameterS
   default:
     throw std::runtime_error("Unknown output mode in GenParticlesFiller");
   }
+
+  registerObjectMap_(genParticleMap_);
 }
 
 void
@@ -246,16 +256,11 @@ GenParticlesFiller::branchNames(suep::utils::BranchList& _eventBranches, suep::u
 }
 
 void
-GenParticlesFiller::addOutput(TFile& _outputFile)
+GenParticlesFiller::eventExtensions(std::vector<EventExtension*>& _extensions)
 {
-  if (fillUnpacked_) {
-    auto* eventTree(static_cast<TTree*>(_outputFile.Get("events")));
-    if (!eventTree) // something is wrong
-      return;
-
-    outUnpacked.book(*eventTree);
-    outputTree_ = eventTree;
-  }
+  // genParticlesU is not a member of suep::Event; the writers book and copy it
+  if (fillUnpacked_)
+    _extensions.push_back(&unpacked_);
 }
 
 void
@@ -267,29 +272,26 @@ GenParticlesFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm
   if (!finalStateParticlesToken_.second.isUninitialized())
     inFinalStates = &getProduct_(_inEvent, finalStateParticlesToken_);
 
-  std::map<reco::CandidatePtr, PNodeWithPtr*> nodeMap;
-  std::vector<PNodeWithPtr*> rootNodes;
-  std::vector<PNodeWithPtr*> orphans;
-
-  // A global set for tracking which PNodeWithPtr came from packed collection
-  miniaodPacked.clear();
+  NodeMap nodeMap(getArena_());
+  ScratchVector<PNodeWithPtr*> rootNodes(getArena_());
+  ScratchVector<PNodeWithPtr*> orphans(getArena_());
 
   for (unsigned iP(0); iP != inParticles.size(); ++iP) {
     auto& inCand(inParticles.at(iP));
     if (inCand.motherRefVector().size() == 0)
-      rootNodes.push_back(new PNodeWithPtr(inParticles.ptrAt(iP), nodeMap));
+      rootNodes.push_back(PNodeWithPtr::make(inParticles.ptrAt(iP), nodeMap));
   }
   
   if (inFinalStates) {
     for (unsigned iP(0); iP != inFinalStates->size(); ++iP) {
-      auto* finalState(new PNodeWithPtr(inFinalStates->ptrAt(iP), nodeMap));
-      miniaodPacked.insert(finalState);
+      auto* finalState(PNodeWithPtr::make(inFinalStates->ptrAt(iP), nodeMap));
       if (!finalState->mother)
         orphans.push_back(finalState);
     }
   }
 
   auto& outPacked(_outEvent.genParticles);
+  auto& outUnpacked(unpacked_.collection);
   if (fillUnpacked_)
     outUnpacked.init();
 
@@ -304,7 +306,7 @@ GenParticlesFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm
   if (fillUnpacked_)
     outUnpacked.reserve(totalSize);
   
-  auto& objectMap(objectMap_->get<reco::Candidate, suep::GenParticle>());
+  auto& objectMap(*genParticleMap_);
 
   for (auto* rootNode : rootNodes) {
     if (furtherPrune_)
@@ -324,12 +326,9 @@ GenParticlesFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm
       orphan->fillSUEP(outUnpacked);
   }
 
-  // ownDaughter is false; need to clean up pnodes
+  // ownDaughter is false; need to clean up pnodes. The memory goes back with the arena
   for (auto& node : nodeMap)
-    delete node.second;
-
-  if (fillUnpacked_)
-    outUnpacked.prepareFill(*outputTree_);
+    node.second->~PNodeWithPtr();
 }
 
 DEFINE_TREEFILLER(GenParticlesFiller);
@@ -10,6 +10,9 @@ HLTFiller::HLTFiller(std::string const& _name, edm::ParameterSet const& _cfg, ed
   // Trigger object collection name was different in 2017A PromptReco
   // Using notifyNewProduct() to dynamically find the tag
   triggerObjectsToken_.first = "triggerObjects";
+
+  registerObjectMap_(hltObjectMap_);
+  registerObjectMap_(hltNameMap_);
 }
 
 HLTFiller::~HLTFiller()
@@ -21,6 +24,8 @@ HLTFiller::addOutput(TFile& _outputFile)
 {
   TDirectory::TContext context(&_outputFile);
   hltTree_ = new TTree("hlt", "HLT");
+  // menu indices refer to the entries of the tree
+  menuMap_.clear();
 }
 
 void
@@ -95,6 +100,19 @@ HLTFiller::fillBeginRun(suep::Run& _outRun, edm::Run const& _inRun, edm::EventSe
   hltTree_->Fill();
 }
 
+void
+HLTFiller::afterRollover(suep::Run& _outRun)
+{
+  if (!_outRun.hlt.menu || _outRun.hlt.menu->IsNull())
+    return;
+
+  // the menu of the current run is the first entry in the new hlt tree
+  _outRun.hltMenu = 0;
+  menuMap_.emplace(*_outRun.hlt.menu, 0);
+
+  hltTree_->Fill();
+}
+
 void
 HLTFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventSetup const& _setup)
 {
@@ -109,9 +127,9 @@ HLTFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventSe
       outHLT.set(iF);
   }
 
-  auto& objMap(objectMap_->get<pat::TriggerObjectStandAlone, suep::HLTObject>());
+  auto& objMap(*hltObjectMap_);
   // This is used in trigger object matching
-  auto& nameMap(objectMap_->get<pat::TriggerObjectStandAlone, VString>());
+  auto& nameMap(*hltNameMap_);
 
   // Resize first so that the pointers don't become in the loop
   filterNames_.resize(inTriggerObjects.size());
@@ -0,0 +1,237 @@
+#include "../interface/JetCorrectionTables.h"
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "CondFormats/JetMETObjects/interface/JetResolutionObject.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  enum BinSource {
+    kEta,
+    kAbsEta,
+    kRho
+  };
+
+  float
+  lerp(float _x, float _x0, float _x1, float _y0, float _y1)
+  {
+    if (_x1 == _x0)
+      return 0.5 * (_y0 + _y1);
+    return _y0 + (_y1 - _y0) * (_x - _x0) / (_x1 - _x0);
+  }
+}
+
+JECUncertaintyTable::JECUncertaintyTable(JetCorrectorParameters const& _params)
+{
+  auto& definitions(_params.definitions());
+  if (definitions.binVar() != std::vector<std::string>{"JetEta"} || definitions.parVar() != std::vector<std::string>{"JetPt"})
+    throw cms::Exception("Configuration") << "JECUncertaintyTable supports JEC uncertainties binned in JetEta with JetPt parameter only";
+
+  gridStart_.push_back(0);
+
+  for (unsigned iB(0); iB != _params.size(); ++iB) {
+    auto& record(_params.record(iB));
+    auto& p(record.parameters());
+    if (p.size() % 3 != 0)
+      throw cms::Exception("Configuration") << "JEC uncertainty record with " << p.size() << " parameters (multiple of 3 expected)";
+
+    etaMin_.push_back(record.xMin(0));
+    etaMax_.push_back(record.xMax(0));
+    if (iB != 0 && etaMin_[iB] < etaMax_[iB - 1])
+      sorted_ = false;
+
+    for (unsigned iP(0); iP < p.size(); iP += 3) {
+      pt_.push_back(p[iP]);
+      up_.push_back(p[iP + 1]);
+      down_.push_back(p[iP + 2]);
+    }
+    gridStart_.push_back(pt_.size());
+  }
+}
+
+void
+JECUncertaintyTable::evaluate(unsigned _n, float const* _eta, float const* _pt, float* _up, float* _down) const
+{
+  for (unsigned iJ(0); iJ != _n; ++iJ) {
+    int bin(findBin_(_eta[iJ]));
+    if (bin < 0) {
+      _up[iJ] = -999.;
+      _down[iJ] = -999.;
+      continue;
+    }
+
+    unsigned begin(gridStart_[bin]);
+    unsigned end(gridStart_[bin + 1]);
+    if (begin == end) {
+      _up[iJ] = 1.;
+      _down[iJ] = 1.;
+      continue;
+    }
+
+    float pt(_pt[iJ]);
+    if (pt <= pt_[begin]) {
+      _up[iJ] = up_[begin];
+      _down[iJ] = down_[begin];
+    }
+    else if (pt >= pt_[end - 1]) {
+      _up[iJ] = up_[end - 1];
+      _down[iJ] = down_[end - 1];
+    }
+    else {
+      // i such that pt_[i] <= pt < pt_[i + 1]
+      unsigned i(std::upper_bound(pt_.begin() + begin, pt_.begin() + end, pt) - pt_.begin() - 1);
+      _up[iJ] = lerp(pt, pt_[i], pt_[i + 1], up_[i], up_[i + 1]);
+      _down[iJ] = lerp(pt, pt_[i], pt_[i + 1], down_[i], down_[i + 1]);
+    }
+  }
+}
+
+int
+JECUncertaintyTable::findBin_(float _eta) const
+{
+  if (sorted_) {
+    auto itr(std::upper_bound(etaMin_.begin(), etaMin_.end(), _eta));
+    if (itr == etaMin_.begin())
+      return -1;
+    unsigned bin(itr - etaMin_.begin() - 1);
+    return _eta < etaMax_[bin] ? int(bin) : -1;
+  }
+
+  for (unsigned iB(0); iB != etaMin_.size(); ++iB) {
+    if (_eta >= etaMin_[iB] && _eta < etaMax_[iB])
+      return iB;
+  }
+  return -1;
+}
+
+JERRecordFinder::JERRecordFinder(JME::JetResolutionObject const& _object) :
+  nRecords_(_object.getRecords().size()),
+  nBins_(_object.getDefinition().nBins())
+{
+  for (auto& bin : _object.getDefinition().getBins()) {
+    switch (bin) {
+    case JME::Binning::JetEta:
+      binSource_.push_back(kEta);
+      break;
+    case JME::Binning::JetAbsEta:
+      binSource_.push_back(kAbsEta);
+      break;
+    case JME::Binning::Rho:
+      binSource_.push_back(kRho);
+      break;
+    default:
+      throw cms::Exception("Configuration") << "JER payload binned in unsupported variable " << _object.getDefinition().getBinName(binSource_.size());
+    }
+  }
+
+  for (auto& record : _object.getRecords()) {
+    for (auto& range : record.getBinsRange()) {
+      min_.push_back(range.min);
+      max_.push_back(range.max);
+    }
+  }
+}
+
+int
+JERRecordFinder::find(float _eta, float _rho) const
+{
+  float values[3] = {_eta, std::abs(_eta), _rho};
+
+  float const* min(min_.data());
+  float const* max(max_.data());
+  for (unsigned iR(0); iR != nRecords_; ++iR, min += nBins_, max += nBins_) {
+    unsigned iB(0);
+    for (; iB != nBins_; ++iB) {
+      float v(values[binSource_[iB]]);
+      if (!(v >= min[iB] && v <= max[iB]))
+        break;
+    }
+    if (iB == nBins_)
+      return iR;
+  }
+  return -1;
+}
+
+JetResolutionTable::JetResolutionTable(JME::JetResolutionObject const& _object) :
+  records_(_object)
+{
+  auto& variables(_object.getDefinition().getVariables());
+  if (variables.size() != 1 || variables[0] != JME::Binning::JetPt)
+    throw cms::Exception("Configuration") << "JetResolutionTable supports resolutions parametrized in JetPt only";
+
+  values_.reserve(records_.size() * kGridSize);
+
+  for (auto& record : _object.getRecords()) {
+    auto& range(record.getVariablesRange()[0]);
+    double logMin(std::log(std::max(range.min, 1.e-3f)));
+    double logMax(std::log(std::max(range.max, range.min + 1.e-3f)));
+    double step((logMax - logMin) / (kGridSize - 1));
+
+    logPtMin_.push_back(logMin);
+    invStep_.push_back(1. / step);
+
+    JME::JetParameters params;
+    for (unsigned iG(0); iG != kGridSize; ++iG) {
+      params.setJetPt(std::exp(logMin + step * iG));
+      values_.push_back(_object.evaluateFormula(record, params));
+    }
+  }
+}
+
+void
+JetResolutionTable::evaluate(unsigned _n, float const* _eta, float const* _pt, float _rho, float* _resolution) const
+{
+  for (unsigned iJ(0); iJ != _n; ++iJ) {
+    int record(records_.find(_eta[iJ], _rho));
+    if (record < 0) {
+      _resolution[iJ] = 1.;
+      continue;
+    }
+
+    float x((std::log(std::max(_pt[iJ], 1.e-3f)) - logPtMin_[record]) * invStep_[record]);
+    x = std::min(std::max(x, 0.f), float(kGridSize - 1));
+    unsigned i(std::min(unsigned(x), kGridSize - 2));
+    float frac(x - i);
+
+    float const* values(values_.data() + record * kGridSize);
+    _resolution[iJ] = values[i] + (values[i + 1] - values[i]) * frac;
+  }
+}
+
+JetResolutionSFTable::JetResolutionSFTable(JME::JetResolutionObject const& _object) :
+  records_(_object)
+{
+  if (_object.getDefinition().nVariables() != 0)
+    throw cms::Exception("Configuration") << "JetResolutionSFTable supports scale factors without variables only";
+
+  for (auto& record : _object.getRecords()) {
+    auto& p(record.getParametersValues());
+    if (p.size() < 3)
+      throw cms::Exception("Configuration") << "JER scale factor record with " << p.size() << " parameters (3 expected)";
+
+    values_.insert(values_.end(), p.begin(), p.begin() + 3);
+  }
+}
+
+void
+JetResolutionSFTable::evaluate(unsigned _n, float const* _eta, float* _sf, float* _sfUp, float* _sfDown) const
+{
+  for (unsigned iJ(0); iJ != _n; ++iJ) {
+    int record(records_.find(_eta[iJ], 0.));
+    if (record < 0) {
+      _sf[iJ] = 1.;
+      _sfUp[iJ] = 1.;
+      _sfDown[iJ] = 1.;
+      continue;
+    }
+
+    // parameter order follows Variation (NOMINAL, DOWN, UP)
+    float const* values(values_.data() + record * 3);
+    _sf[iJ] = values[0];
+    _sfDown[iJ] = values[1];
+    _sfUp[iJ] = values[2];
+  }
+}
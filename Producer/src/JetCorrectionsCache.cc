@@ -0,0 +1,46 @@
+#include "../interface/JetCorrectionsCache.h"
+
+#include "FWCore/Framework/interface/ESHandle.h"
+
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "JetMETCorrections/Modules/interface/JetResolution.h"
+
+JECUncertaintyTable const&
+JetCorrectionsCache::getJEC(edm::EventSetup const& _setup, std::string const& _jecName)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (jecWatcher_.check(_setup))
+    jec_.clear();
+
+  auto jItr(jec_.find(_jecName));
+  if (jItr == jec_.end()) {
+    edm::ESHandle<JetCorrectorParametersCollection> jecColl;
+    _setup.get<JetCorrectionsRecord>().get(_jecName, jecColl);
+    jItr = jec_.emplace(_jecName, JECUncertaintyTable((*jecColl)["Uncertainty"])).first;
+  }
+
+  return jItr->second;
+}
+
+JetCorrectionsCache::JER const&
+JetCorrectionsCache::getJER(edm::EventSetup const& _setup, std::string const& _jerName)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // evaluate both watchers - check() also records the new cache identifier
+  bool resChanged(jerWatcher_.check(_setup));
+  bool sfChanged(jerSFWatcher_.check(_setup));
+  if (resChanged || sfChanged)
+    jer_.clear();
+
+  auto jItr(jer_.find(_jerName));
+  if (jItr == jer_.end()) {
+    JER jer;
+    jer.ptRes = JetResolutionTable(*JME::JetResolution::get(_setup, _jerName + "_pt").getResolutionObject());
+    jer.ptResSF = JetResolutionSFTable(*JME::JetResolutionScaleFactor::get(_setup, _jerName).getResolutionObject());
+    jItr = jer_.emplace(_jerName, std::move(jer)).first;
+  }
+
+  return jItr->second;
+}
@@ -1,6 +1,6 @@
 #include "../interface/JetsFiller.h"
+#include "../interface/JetCorrectionsCache.h"
 
-#include "FWCore/Framework/interface/ESHandle.h"
 #include "FWCore/ServiceRegistry/interface/Service.h"
 #include "FWCore/Utilities/interface/RandomNumberGenerator.h"
 
@@ -11,11 +11,7 @@
 #include "CLHEP/Random/RandomEngine.h"
 #include "CLHEP/Random/RandGauss.h"
 
-#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
-#include "CondFormats/JetMETObjects/interface/JetCorrectionUncertainty.h"
-#include "JetMETCorrections/Objects/interface/JetCorrectionsRecord.h"
 #include "JetMETCorrections/Objects/interface/JetCorrector.h"
-#include "JetMETCorrections/Modules/interface/JetResolution.h"
 
 #include <cmath>
 #include <stdexcept>
@@ -36,7 +32,10 @@ JetsFiller::JetsFiller(std::string const& _name, edm::ParameterSet const& _cfg,
   minPt_(getParameter_<double>(_cfg, "minPt", 15.)),
   maxEta_(getParameter_<double>(_cfg, "maxEta", 4.7)),
   fillConstituents_(getParameter_<bool>(_cfg, "fillConstituents", false)),
-  subjetsOffset_(getParameter_<unsigned>(_cfg, "subjetsOffset", 0))
+  subjetsOffset_(getParameter_<unsigned>(_cfg, "subjetsOffset", 0)),
+  uniqueGenJetMatch_(getParameter_<bool>(_cfg, "uniqueGenJetMatch", false)),
+  genJetMatcher_(R_ * 0.5),
+  puidMatcher_(0.2)
 {
   if (_name == "chsAK4Jets")
     outputSelector_ = [](suep::Event& _event)->suep::JetCollection& { return _event.chsAK4Jets; };
@@ -56,13 +55,26 @@ JetsFiller::JetsFiller(std::string const& _name, edm::ParameterSet const& _cfg,
     getToken_(rhoToken_, _cfg, _coll, "rho", "rho");
   }
 
+  registerObjectMap_(jetMap_);
+  registerObjectMap_(genJetMap_);
+
+  if (fillConstituents_)
+    consumesObjectMap_(pfMap_, "pfCandidates", constituentsLabel_);
+  if (!csvTag_.empty()) {
+    consumesObjectMap_(svMap_, "secondaryVertices");
+    consumesObjectMap_(pvMap_, "vertices");
+  }
+  if (!isRealData_ && !outGenJets_.empty())
+    consumesObjectMap_(genMap_, outGenJets_);
+  if (!isRealData_ && !jerName_.empty())
+    usesSharedResource_("RandomNumberGenerator");
+
   // Check the enums and map
   assert(deepProbs.size() == deepSuff::DEEP_SIZE);
 }
 
 JetsFiller::~JetsFiller()
 {
-  delete jecUncertainty_;
 }
 
 void
@@ -108,6 +120,16 @@ JetsFiller::branchNames(suep::utils::BranchList& _eventBranches, suep::utils::Br
     _eventBranches.emplace_back("!" + getName() + ".constituents_");
 }
 
+void
+JetsFiller::setBookedBranches(suep::utils::BranchList const& _eventBranches, suep::utils::BranchList const&)
+{
+  // references are only worth setting if they are written
+  if (fillConstituents_ && !isBooked_(_eventBranches, getName() + ".constituents_"))
+    fillConstituents_ = false;
+
+  linkSecondaryVertex_ = !csvTag_.empty() && isBooked_(_eventBranches, getName() + ".secondaryVertex_");
+}
+
 void
 JetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventSetup const& _setup)
 {
@@ -115,15 +137,14 @@ JetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventS
 
   suep::JetCollection& outJets(outputSelector_(_outEvent));
 
-  if (!jecUncertainty_ && !jecName_.empty()) {
-    edm::ESHandle<JetCorrectorParametersCollection> jecColl;
-    _setup.get<JetCorrectionsRecord>().get(jecName_, jecColl);
-    jecUncertainty_ = new JetCorrectionUncertainty((*jecColl)["Uncertainty"]);
+  JECUncertaintyTable const* jec(0);
+  if (!jecName_.empty()) {
+    auto lock(lockFramework_());
+    jec = &getJetCorrectionsCache_().getJEC(_setup, jecName_);
   }
 
   GenJetView const* genJets(0);
-  JME::JetResolution ptRes;
-  JME::JetResolutionScaleFactor ptResSF;
+  JetCorrectionsCache::JER const* jer(0);
   double rho(0.);
   CLHEP::RandGauss* random(0);
   
@@ -132,18 +153,96 @@ JetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventS
       genJets = &getProduct_(_inEvent, genJetsToken_);
 
     if (!jerName_.empty()) {
-      ptRes = JME::JetResolution::get(_setup, jerName_ + "_pt");
-      ptResSF = JME::JetResolutionScaleFactor::get(_setup, jerName_);
+      {
+        auto lock(lockFramework_());
+        jer = &getJetCorrectionsCache_().getJER(_setup, jerName_);
+      }
 
       rho = getProduct_(_inEvent, rhoToken_);
       random = new CLHEP::RandGauss(edm::Service<edm::RandomNumberGenerator>()->getEngine(_inEvent.streamID()));
     }
   }
 
+  // evaluate the JEC uncertainties and JER for all input jets at once (arrays indexed by input jet)
+  unsigned nInJets(inJets.size());
+  ScratchVector<float> inPt(nInJets, getArena_());
+  ScratchVector<float> inEta(nInJets, getArena_());
+  ScratchVector<float> inPhi(nInJets, getArena_());
+  for (unsigned iJ(0); iJ != nInJets; ++iJ) {
+    inPt[iJ] = inJets[iJ].pt();
+    inEta[iJ] = inJets[iJ].eta();
+    inPhi[iJ] = inJets[iJ].phi();
+  }
+
+  ScratchVector<float> jecUp(getArena_());
+  ScratchVector<float> jecDown(getArena_());
+  if (jec) {
+    jecUp.resize(nInJets);
+    jecDown.resize(nInJets);
+    jec->evaluate(nInJets, inEta.data(), inPt.data(), jecUp.data(), jecDown.data());
+  }
+
+  ScratchVector<float> ptRes(getArena_());
+  ScratchVector<float> ptResSF(getArena_());
+  ScratchVector<float> ptResSFUp(getArena_());
+  ScratchVector<float> ptResSFDown(getArena_());
+  if (jer) {
+    ptRes.resize(nInJets);
+    ptResSF.resize(nInJets);
+    ptResSFUp.resize(nInJets);
+    ptResSFDown.resize(nInJets);
+    jer->ptRes.evaluate(nInJets, inEta.data(), inPt.data(), rho, ptRes.data());
+    jer->ptResSF.evaluate(nInJets, inEta.data(), ptResSF.data(), ptResSFUp.data(), ptResSFDown.data());
+  }
+
   auto* puidJets(puidJetsToken_.second.isUninitialized() ? nullptr : &getProduct_(_inEvent, puidJetsToken_));
 
-  std::vector<edm::Ptr<reco::Jet>> ptrList;
-  std::vector<edm::Ptr<reco::GenJet>> matchedGenJets;
+  // gen jet and pileup-id jet matches (indices, -1 if none) of the input jets
+  ScratchVector<int> genJetMatch(nInJets, -1, getArena_());
+  ScratchVector<int> puidMatch(nInJets, -1, getArena_());
+
+  if (genJets) {
+    genJetMatcher_.clear();
+    genJetMatcher_.reserve(genJets->size());
+    for (auto& genJet : *genJets)
+      genJetMatcher_.addTarget(genJet.eta(), genJet.phi());
+    genJetMatcher_.build();
+
+    if (uniqueGenJetMatch_) {
+      // only the jets passing the selection compete for the gen jets
+      ScratchVector<unsigned> selected(getArena_());
+      ScratchVector<float> selEta(getArena_());
+      ScratchVector<float> selPhi(getArena_());
+      for (unsigned iJ(0); iJ != nInJets; ++iJ) {
+        if (inJets[iJ].pt() < minPt_ || std::abs(inJets[iJ].eta()) > 4.7)
+          continue;
+        selected.push_back(iJ);
+        selEta.push_back(inEta[iJ]);
+        selPhi.push_back(inPhi[iJ]);
+      }
+
+      ScratchVector<int> selMatch(selected.size(), getArena_());
+      genJetMatcher_.matchUnique(selected.size(), selEta.data(), selPhi.data(), R_ * 0.5, selMatch.data());
+      for (unsigned iS(0); iS != selected.size(); ++iS)
+        genJetMatch[selected[iS]] = selMatch[iS];
+    }
+    else
+      genJetMatcher_.matchNearest(nInJets, inEta.data(), inPhi.data(), R_ * 0.5, genJetMatch.data());
+  }
+
+  if (puidJets) {
+    puidMatcher_.clear();
+    puidMatcher_.reserve(puidJets->size());
+    for (auto& inPuid : *puidJets)
+      puidMatcher_.addTarget(inPuid.eta(), inPuid.phi());
+    puidMatcher_.build();
+
+    puidMatcher_.matchNearest(nInJets, inEta.data(), inPhi.data(), 0.2, puidMatch.data());
+  }
+
+  ScratchVector<edm::Ptr<reco::Jet>> ptrList(getArena_());
+  ScratchVector<edm::Ptr<reco::GenJet>> matchedGenJets(getArena_());
+  ptrList.reserve(inJets.size());
 
   unsigned iJet(-1);
   for (auto& inJet : inJets) {
@@ -163,14 +262,8 @@ JetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventS
       auto& patJet(static_cast<pat::Jet const&>(inJet));
 
       const pat::Jet* puidJet(puidJets == nullptr ? &patJet : nullptr);
-      if (puidJet == nullptr) {
-        for (auto& inPuid : *puidJets) {
-          if (reco::deltaR(patJet, inPuid) < 0.2) {
-            puidJet = &inPuid;
-            break;
-          }
-        }
-      }
+      if (puidJet == nullptr && puidMatch[iJet] >= 0)
+        puidJet = &puidJets->at(puidMatch[iJet]);
 
       double nhf(patJet.neutralHadronEnergyFraction());
       double nef(patJet.neutralEmEnergyFraction());
@@ -204,41 +297,29 @@ JetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventS
 
       outJet.rawPt = patJet.pt() * patJet.jecFactor("Uncorrected");
 
-      if (jecUncertainty_) {
-        jecUncertainty_->setJetEta(inJet.eta());
-        jecUncertainty_->setJetPt(inJet.pt());
-        outJet.ptCorrUp = outJet.pt() * (1. + jecUncertainty_->getUncertainty(true));
-        jecUncertainty_->setJetEta(inJet.eta());
-        jecUncertainty_->setJetPt(inJet.pt());
-        outJet.ptCorrDown = outJet.pt() * (1. - jecUncertainty_->getUncertainty(false));
+      if (jec) {
+        outJet.ptCorrUp = outJet.pt() * (1. + jecUp[iJet]);
+        outJet.ptCorrDown = outJet.pt() * (1. - jecDown[iJet]);
       }
 
       if (!isRealData_) {
         reco::GenJet const* matchedGenJet(0);
 
         if (genJets) {
-          unsigned iG(0);
-          for (; iG != genJets->size(); ++iG) {
-            auto& genJet(genJets->at(iG));
-            if (reco::deltaR(genJet, inJet) < R_ * 0.5) {
-              matchedGenJet = &genJet;
-              break;
-            }
-          }
-          if (iG != genJets->size())
+          int iG(genJetMatch[iJet]);
+          if (iG >= 0) {
+            matchedGenJet = &genJets->at(iG);
             matchedGenJets.emplace_back(genJets->ptrAt(iG));
+          }
           else
             matchedGenJets.emplace_back();
         }
 
-        if (!jerName_.empty()) {
-          JME::JetParameters resParams({{JME::Binning::JetPt, inJet.pt()}, {JME::Binning::JetEta, inJet.eta()}, {JME::Binning::Rho, rho}});
-          double res(ptRes.getResolution(resParams) * inJet.pt());
-
-          JME::JetParameters sfParams({{JME::Binning::JetEta, inJet.eta()}});
-          double sf(ptResSF.getScaleFactor(sfParams));
-          double sfUp(ptResSF.getScaleFactor(sfParams, Variation::UP));
-          double sfDown(ptResSF.getScaleFactor(sfParams, Variation::DOWN));
+        if (jer) {
+          double res(ptRes[iJet] * inJet.pt());
+          double sf(ptResSF[iJet]);
+          double sfUp(ptResSFUp[iJet]);
+          double sfDown(ptResSFDown[iJet]);
 
           if (matchedGenJet && std::abs(inJet.pt() - matchedGenJet->pt()) < res * 3.) {
             double dpt(inJet.pt() - matchedGenJet->pt());
@@ -294,8 +375,8 @@ JetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventS
 
   // export suep <-> reco mapping
 
-  auto& objectMap(objectMap_->get<reco::Jet, suep::Jet>());
-  auto& genJetMap(objectMap_->get<reco::GenJet, suep::Jet>());
+  auto& objectMap(*jetMap_);
+  auto& genJetMap(*genJetMap_);
 
   for (unsigned iP(0); iP != outJets.size(); ++iP) {
     auto& outJet(outJets[iP]);
@@ -315,23 +396,23 @@ JetsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventS
 }
 
 void
-JetsFiller::setRefs(ObjectMapStore const& _objectMaps)
+JetsFiller::setRefs(ObjectMapStore const&)
 {
   if (fillConstituents_) {
-    auto& jetMap(objectMap_->get<reco::Jet, suep::Jet>());
+    auto& jetMap(*jetMap_);
 
-    auto& pfMap(_objectMaps.at("pfCandidates").get<reco::Candidate, suep::PFCand>(constituentsLabel_).fwdMap);
+    auto& pfMap(*pfMap_);
 
-    for (auto& link : jetMap.fwdMap) { // edm -> suep
-      auto& inJet(*link.first);
-      auto& outJet(*link.second);
+    for (auto& link : jetMap) { // edm -> suep
+      auto& inJet(*link.edmPtr);
+      auto& outJet(*link.suepObj);
 
       auto addPFRef([&outJet, &pfMap](reco::CandidatePtr const& _ptr) {
           reco::CandidatePtr p(_ptr);
           while (true) {
-            auto&& mItr(pfMap.find(p));
-            if (mItr != pfMap.end()) {
-              outJet.constituents.addRef(mItr->second);
+            auto* outPF(pfMap.find(p));
+            if (outPF) {
+              outJet.constituents.addRef(outPF);
               break;
             }
             else {
@@ -365,45 +446,45 @@ JetsFiller::setRefs(ObjectMapStore const& _objectMaps)
   }
 
   // Set the references to the secondary vertices
-  if (!csvTag_.empty()) {
+  if (linkSecondaryVertex_) {
 
-    auto& jetMap(objectMap_->get<reco::Jet, suep::Jet>());
-    auto& svMap(_objectMaps.at("secondaryVertices").get<reco::VertexCompositePtrCandidate, suep::SecondaryVertex>());
-    auto& pvMap(_objectMaps.at("vertices").get<reco::Vertex, suep::RecoVertex>());
+    auto& jetMap(*jetMap_);
+    auto& svMap(*svMap_);
+    auto& pvMap(*pvMap_);
 
     edm::Ptr<reco::Vertex> pv;
 
     float maxScore(0);
-    for (auto& vtxLink : pvMap.fwdMap) {
+    for (auto& vtxLink : pvMap) {
 
-      auto outVtx(*vtxLink.second);
+      auto outVtx(*vtxLink.suepObj);
       if (outVtx.score > maxScore) {
 
         maxScore = outVtx.score;
-        pv = vtxLink.first;
+        pv = vtxLink.edmPtr;
 
       }
     }
 
-    for (auto& jetLink : jetMap.fwdMap) {   // edm -> suep
+    for (auto& jetLink : jetMap) {   // edm -> suep
       float maxSignificance(0);
 
-      auto& inJet(*jetLink.first);
-      auto& outJet(*jetLink.second);
+      auto& inJet(*jetLink.edmPtr);
+      auto& outJet(*jetLink.suepObj);
 
       suep::SecondaryVertex* matchedSV(nullptr);
 
-      for (auto& svLink : svMap.fwdMap) {   // edm -> suep
+      for (auto& svLink : svMap) {   // edm -> suep
 
-        auto inLocation = svLink.first->vertex();
+        auto inLocation = svLink.edmPtr->vertex();
         if (Geom::deltaR2(GlobalVector(inLocation.x() - pv->x(), inLocation.y() - pv->y(), inLocation.z() - pv->z()),
                           GlobalVector(inJet.px(), inJet.py(), inJet.pz())) < 0.09){
 
-          auto& outSV(*svLink.second);
+          auto& outSV(*svLink.suepObj);
 
           if (outSV.significance > maxSignificance) {
             maxSignificance = outSV.significance;
-            matchedSV = svLink.second;
+            matchedSV = svLink.suepObj;
           }
         }
       }
@@ -415,17 +496,21 @@ JetsFiller::setRefs(ObjectMapStore const& _objectMaps)
   }
 
   if (!isRealData_ && !outGenJets_.empty()) {
-    auto& genJetMap(objectMap_->get<reco::GenJet, suep::Jet>().fwdMap);
+    auto& genJetMap(*genJetMap_);
 
-    auto& genMap(_objectMaps.at(outGenJets_).get<reco::GenJet, suep::GenJet>().fwdMap);
+    auto& genMap(*genMap_);
 
     for (auto& link : genJetMap) {
-      auto& genPtr(link.first);
-      if (genMap.find(genPtr) == genMap.end())
+      // a gen jet matched to several jets is linked to the first one only
+      if (!genJetMap.isFirst(link))
+        continue;
+
+      auto* outGenJet(genMap.find(link.edmPtr));
+      if (!outGenJet)
         continue;
 
-      auto& outJet(*link.second);
-      outJet.matchedGenJet.setRef(genMap.at(genPtr));
+      auto& outJet(*link.suepObj);
+      outJet.matchedGenJet.setRef(outGenJet);
     }
   }
 }
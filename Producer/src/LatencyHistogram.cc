@@ -0,0 +1,95 @@
+#include "../interface/LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  double const minNS(100.);
+}
+
+void
+LatencyHistogram::fill(Duration const& _dt)
+{
+  long long ns(std::chrono::duration_cast<std::chrono::nanoseconds>(_dt).count());
+
+  unsigned iB(0);
+  if (ns >= minNS) {
+    iB = 1 + unsigned(std::log10(ns / minNS) * nBinsPerDecade);
+    if (iB >= nBins)
+      iB = nBins - 1;
+  }
+
+  ++counts_[iB];
+  ++count_;
+  sumNS_ += ns;
+  if (ns > maxNS_)
+    maxNS_ = ns;
+}
+
+void
+LatencyHistogram::add(LatencyHistogram const& _other)
+{
+  for (unsigned iB(0); iB != nBins; ++iB)
+    counts_[iB] += _other.counts_[iB];
+
+  count_ += _other.count_;
+  sumNS_ += _other.sumNS_;
+  if (_other.maxNS_ > maxNS_)
+    maxNS_ = _other.maxNS_;
+}
+
+double
+LatencyHistogram::getMean() const
+{
+  if (count_ == 0)
+    return 0.;
+
+  return sumNS_ / count_ * 1.e-6;
+}
+
+double
+LatencyHistogram::getQuantile(double _q) const
+{
+  if (count_ == 0)
+    return 0.;
+
+  // rank of the requested entry (1-based)
+  unsigned long long rank(std::ceil(_q * count_));
+  if (rank == 0)
+    rank = 1;
+
+  unsigned long long sum(0);
+  unsigned iB(0);
+  for (; iB != nBins - 1; ++iB) {
+    sum += counts_[iB];
+    if (sum >= rank)
+      break;
+  }
+
+  return std::min(upperEdgeNS_(iB), double(maxNS_)) * 1.e-6;
+}
+
+TH1D*
+LatencyHistogram::makeTH1(char const* _name, char const* _title) const
+{
+  // underflow and overflow buckets are mapped to the TH1 underflow and overflow
+  std::vector<double> edges(nBins - 1);
+  edges[0] = minNS * 1.e-6;
+  for (unsigned iB(1); iB != nBins - 1; ++iB)
+    edges[iB] = upperEdgeNS_(iB) * 1.e-6;
+
+  auto* hist(new TH1D(_name, _title, nBins - 2, edges.data()));
+  for (unsigned iB(0); iB != nBins; ++iB)
+    hist->SetBinContent(iB, counts_[iB]);
+
+  hist->SetEntries(count_);
+
+  return hist;
+}
+
+/*static*/
+double
+LatencyHistogram::upperEdgeNS_(unsigned _iB)
+{
+  return minNS * std::pow(10., double(_iB) / nBinsPerDecade);
+}
@@ -98,49 +98,21 @@ MetExtraFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Ev
   }
 
   if (candidates) {
-    double trkMex(0.);
-    double trkMey(0.);
-    double neutralMex(0.);
-    double neutralMey(0.);
-    double photonMex(0.);
-    double photonMey(0.);
-    double hfMex(0.);
-    double hfMey(0.);
-
-    for (auto& cand : *candidates) {
-      if (std::abs(cand.pdgId()) == 13) {
-        noMuMex += cand.px();
-        noMuMey += cand.py();
-      }
-      else if (cand.pdgId() == 130) {
-        neutralMex -= cand.px();
-        neutralMey -= cand.py();
-      }
-      else if (cand.pdgId() == 22) {
-        photonMex -= cand.px();
-        photonMey -= cand.py();
-      }
-      else if (cand.pdgId() == 1 || cand.pdgId() == 2) {
-        hfMex -= cand.px();
-        hfMey -= cand.py();
-      }
+    // momentum sums are computed in the shared pass over the candidates
+    auto& snapshot(getPFCandidateSnapshot_(*candidates));
 
-      if (cand.charge() != 0) {
-        trkMex -= cand.px();
-        trkMey -= cand.py();
-      }
-    }
+    typedef PFCandidateSnapshot S;
 
     if (enabled_[kNoMu])
-      _outEvent.noMuMet.setXY(noMuMex, noMuMey);
+      _outEvent.noMuMet.setXY(noMuMex + snapshot.sumPx(S::kMuon), noMuMey + snapshot.sumPy(S::kMuon));
     if (enabled_[kTrk])
-      _outEvent.trkMet.setXY(trkMex, trkMey);
+      _outEvent.trkMet.setXY(-snapshot.sumPx(S::kCharged), -snapshot.sumPy(S::kCharged));
     if (enabled_[kNeutral])
-      _outEvent.neutralMet.setXY(neutralMex, neutralMey);
+      _outEvent.neutralMet.setXY(-snapshot.sumPx(S::kNeutralHadron), -snapshot.sumPy(S::kNeutralHadron));
     if (enabled_[kPhoton])
-      _outEvent.photonMet.setXY(photonMex, photonMey);
+      _outEvent.photonMet.setXY(-snapshot.sumPx(S::kPhoton), -snapshot.sumPy(S::kPhoton));
     if (enabled_[kHF])
-      _outEvent.hfMet.setXY(hfMex, hfMey);
+      _outEvent.hfMet.setXY(-snapshot.sumPx(S::kHF), -snapshot.sumPy(S::kHF));
   }
 }
 
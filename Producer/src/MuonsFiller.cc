@@ -19,6 +19,18 @@ MuonsFiller::MuonsFiller(std::string const& _name, edm::ParameterSet const& _cfg
 {
   getToken_(muonsToken_, _cfg, _coll, "muons");
   getToken_(verticesToken_, _cfg, _coll, "common", "vertices");
+
+  registerObjectMap_(muMuMap_);
+  registerObjectMap_(pfMuMap_, "pf");
+  registerObjectMap_(vtxMuMap_);
+  registerObjectMap_(genMuMap_, "gen");
+
+  consumesObjectMap_(pfMap_, "pfCandidates");
+  consumesObjectMap_(vtxMap_, "vertices");
+  if (!isRealData_) {
+    consumesObjectMap_(genMap_, "genParticles");
+    usesSharedResource_("RandomNumberGenerator");
+  }
 }
 
 void
@@ -180,10 +192,10 @@ MuonsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Event
 
   // export suep <-> reco mapping
 
-  auto& muMuMap(objectMap_->get<reco::Muon, suep::Muon>());
-  auto& pfMuMap(objectMap_->get<reco::Candidate, suep::Muon>("pf"));
-  auto& vtxMuMap(objectMap_->get<reco::Vertex, suep::Muon>());
-  auto& genMuMap(objectMap_->get<reco::Candidate, suep::Muon>("gen"));
+  auto& muMuMap(*muMuMap_);
+  auto& pfMuMap(*pfMuMap_);
+  auto& vtxMuMap(*vtxMuMap_);
+  auto& genMuMap(*genMuMap_);
 
   for (unsigned iP(0); iP != outMuons.size(); ++iP) {
     auto& outMuon(outMuons[iP]);
@@ -214,45 +226,46 @@ MuonsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Event
 }
 
 void
-MuonsFiller::setRefs(ObjectMapStore const& _objectMaps)
+MuonsFiller::setRefs(ObjectMapStore const&)
 {
-  auto& pfMuMap(objectMap_->get<reco::Candidate, suep::Muon>("pf"));
-  auto& vtxMuMap(objectMap_->get<reco::Vertex, suep::Muon>());
+  auto& pfMuMap(*pfMuMap_);
+  auto& vtxMuMap(*vtxMuMap_);
 
-  auto& pfMap(_objectMaps.at("pfCandidates").get<reco::Candidate, suep::PFCand>().fwdMap);
-  auto& vtxMap(_objectMaps.at("vertices").get<reco::Vertex, suep::RecoVertex>().fwdMap);
+  auto& pfMap(*pfMap_);
+  auto& vtxMap(*vtxMap_);
 
-  for (auto& link : pfMuMap.bwdMap) { // suep -> edm
-    auto& outMuon(*link.first);
-    auto& pfPtr(link.second);
+  for (auto& link : pfMuMap) { // suep -> edm
+    auto& outMuon(*link.suepObj);
+    auto& pfPtr(link.edmPtr);
 
     // muon sourceCandidatePtr can point to the AOD pfCandidates in some cases
-    auto pfItr(pfMap.find(pfPtr));
-    if (pfItr == pfMap.end())
+    auto* outPF(pfMap.find(pfPtr));
+    if (!outPF)
       continue;
 
-    outMuon.matchedPF.setRef(pfItr->second);
+    outMuon.matchedPF.setRef(outPF);
   }
 
-  for (auto& link : vtxMuMap.bwdMap) { // suep -> edm
-    auto& outMuon(*link.first);
-    auto& vtxPtr(link.second);
+  for (auto& link : vtxMuMap) { // suep -> edm
+    auto& outMuon(*link.suepObj);
+    auto& vtxPtr(link.edmPtr);
 
     outMuon.vertex.setRef(vtxMap.at(vtxPtr));
   }
 
   if (!isRealData_) {
-    auto& genMuMap(objectMap_->get<reco::Candidate, suep::Muon>("gen"));
+    auto& genMuMap(*genMuMap_);
 
-    auto& genMap(_objectMaps.at("genParticles").get<reco::Candidate, suep::GenParticle>().fwdMap);
+    auto& genMap(*genMap_);
 
-    for (auto& link : genMuMap.bwdMap) {
-      auto& genPtr(link.second);
-      if (genMap.find(genPtr) == genMap.end())
+    for (auto& link : genMuMap) {
+      auto& genPtr(link.edmPtr);
+      auto* outGen(genMap.find(genPtr));
+      if (!outGen)
         continue;
 
-      auto& outMuon(*link.first);
-      outMuon.matchedGen.setRef(genMap.at(genPtr));
+      auto& outMuon(*link.suepObj);
+      outMuon.matchedGen.setRef(outGen);
     }
   }
 }
@@ -0,0 +1,28 @@
+#include "../interface/PFCandidateIndex.h"
+
+EtaPhiGrid const&
+PFCandidateIndex::get(PFCandidateSnapshot const& _snapshot)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (unsigned iG(0); iG != nUsed_; ++iG) {
+    if (grids_[iG].first == _snapshot.id())
+      return *grids_[iG].second;
+  }
+
+  if (nUsed_ == grids_.size())
+    grids_.emplace_back(edm::ProductID(), std::unique_ptr<EtaPhiGrid>(new EtaPhiGrid));
+
+  auto& entry(grids_[nUsed_++]);
+  entry.first = _snapshot.id();
+
+  auto& grid(*entry.second);
+  grid.clear();
+  grid.reserve(_snapshot.size());
+  for (unsigned iC(0); iC != _snapshot.size(); ++iC)
+    grid.add(_snapshot.eta(iC), _snapshot.phi(iC));
+
+  grid.build();
+
+  return grid;
+}
@@ -0,0 +1,96 @@
+#include "../interface/PFCandidateSnapshot.h"
+
+#include <algorithm>
+
+PFCandidateSnapshot const&
+PFCandidateSnapshotStore::get(edm::View<reco::Candidate> const& _candidates)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // view objects differ between getByToken calls; identify the collection by its product id
+  for (unsigned iS(0); iS != nUsed_; ++iS) {
+    if (snapshots_[iS]->id() == _candidates.id())
+      return *snapshots_[iS];
+  }
+
+  if (nUsed_ == snapshots_.size())
+    snapshots_.emplace_back(new PFCandidateSnapshot);
+
+  auto& snapshot(*snapshots_[nUsed_++]);
+  snapshot.fill(_candidates);
+
+  return snapshot;
+}
+
+void
+PFCandidateSnapshot::fill(edm::View<reco::Candidate> const& _candidates)
+{
+  source_ = _candidates.id();
+
+  unsigned nC(_candidates.size());
+
+  // resize keeps the capacity from the previous events
+  packed_.resize(nC);
+  pdgId_.resize(nC);
+  charge_.resize(nC);
+  pt_.resize(nC);
+  eta_.resize(nC);
+  phi_.resize(nC);
+  vertexKey_.resize(nC);
+
+  std::fill_n(sumPx_, nCategories, 0.);
+  std::fill_n(sumPy_, nCategories, 0.);
+  std::fill(nPerVertex_.begin(), nPerVertex_.end(), 0);
+  charged_.clear();
+
+  for (unsigned iC(0); iC != nC; ++iC) {
+    auto& cand(_candidates.at(iC));
+
+    auto* inPacked(dynamic_cast<pat::PackedCandidate const*>(&cand));
+    packed_[iC] = inPacked;
+
+    int pdgId(cand.pdgId());
+    int charge(cand.charge());
+    double px(cand.px());
+    double py(cand.py());
+
+    pdgId_[iC] = pdgId;
+    charge_[iC] = charge;
+    pt_[iC] = cand.pt();
+    eta_[iC] = cand.eta();
+    phi_[iC] = cand.phi();
+
+    vertexKey_[iC] = -1;
+    if (inPacked) {
+      auto&& vtxRef(inPacked->vertexRef());
+      if (vtxRef.isNonnull()) {
+        unsigned key(vtxRef.key());
+        vertexKey_[iC] = key;
+        if (key >= nPerVertex_.size())
+          nPerVertex_.resize(key + 1, 0);
+        ++nPerVertex_[key];
+      }
+    }
+
+    int category(-1);
+    if (std::abs(pdgId) == 13)
+      category = kMuon;
+    else if (pdgId == 130)
+      category = kNeutralHadron;
+    else if (pdgId == 22)
+      category = kPhoton;
+    else if (pdgId == 1 || pdgId == 2)
+      category = kHF;
+
+    if (category >= 0) {
+      sumPx_[category] += px;
+      sumPy_[category] += py;
+    }
+
+    if (charge != 0) {
+      sumPx_[kCharged] += px;
+      sumPy_[kCharged] += py;
+      charged_.push_back(iC);
+    }
+  }
+}
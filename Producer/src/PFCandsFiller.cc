@@ -6,16 +6,89 @@
 
 #include "SUEPProd/Auxiliary/interface/PackedValuesExposer.h"
 
+#include <cstring>
+
+namespace {
+  //! Ascending in vertex key (as unsigned, so no vertex = -1 goes last), then descending in pt
+  uint64_t
+  sortKey(int _vertexKey, float _pt)
+  {
+    uint32_t ptBits;
+    std::memcpy(&ptBits, &_pt, sizeof(ptBits)); // monotonic in pt for pt >= 0
+    return (uint64_t(uint32_t(_vertexKey)) << 32) | ~ptBits;
+  }
+
+  //! Stable LSD radix sort; order receives the indices of the keys in ascending order
+  template<class Keys, class Indices>
+  void
+  radixSort(Keys const& _keys, Indices& _order, Indices& _buffer)
+  {
+    unsigned const nDigits(8);
+    unsigned n(_keys.size());
+
+    _order.resize(n);
+    _buffer.resize(n);
+    for (unsigned i(0); i != n; ++i)
+      _order[i] = i;
+
+    // histograms of all digits in one pass
+    unsigned counts[nDigits][256] = {};
+    for (uint64_t key : _keys) {
+      for (unsigned iD(0); iD != nDigits; ++iD)
+        ++counts[iD][(key >> (8 * iD)) & 0xff];
+    }
+
+    for (unsigned iD(0); iD != nDigits; ++iD) {
+      auto& count(counts[iD]);
+
+      // digits shared by all keys (e.g. high bits of the vertex key) need no pass
+      if (n == 0 || count[(_keys[0] >> (8 * iD)) & 0xff] == n)
+        continue;
+
+      unsigned offsets[256];
+      unsigned sum(0);
+      for (unsigned iB(0); iB != 256; ++iB) {
+        offsets[iB] = sum;
+        sum += count[iB];
+      }
+
+      for (unsigned i : _order)
+        _buffer[offsets[(_keys[i] >> (8 * iD)) & 0xff]++] = i;
+
+      _order.swap(_buffer);
+    }
+  }
+}
+
 PFCandsFiller::PFCandsFiller(std::string const& _name, edm::ParameterSet const& _cfg, edm::ConsumesCollector& _coll) :
   FillerBase(_name, _cfg),
-  useExistingWeights_(getParameter_<bool>(_cfg, "useExistingWeights", true))
+  useExistingWeights_(getParameter_<bool>(_cfg, "useExistingWeights", true)),
+  thinning_(getParameter_<bool>(_cfg, "thinning", false)),
+  defaultMinPt_(getParameter_<double>(_cfg, "defaultMinPt", 0.)),
+  minPuppiWeight_(getParameter_<double>(_cfg, "minPuppiWeight", -1.)),
+  minChargedFromPV_(getParameter_<int>(_cfg, "minChargedFromPV", 0))
 {
+  for (auto& spec : getParameter_<VString>(_cfg, "minPtByPdgId", VString())) {
+    size_t colon(spec.find(':'));
+    if (colon == std::string::npos)
+      throw edm::Exception(edm::errors::Configuration, "Invalid minPtByPdgId entry " + spec + " (expected pdgId:minPt)");
+
+    minPtByPdgId_[std::abs(std::stoi(spec.substr(0, colon)))] = std::stod(spec.substr(colon + 1));
+  }
+
+  for (auto& tag : getParameter_<VString>(_cfg, "keepReferencedBy", VString()))
+    keepReferencedByTokens_.emplace_back(tag, _coll.consumes<reco::CandidateView>(edm::InputTag(tag)));
+
   getToken_(candidatesToken_, _cfg, _coll, "common", "pfCandidates");
   getToken_(puppiMapToken_, _cfg, _coll, "puppiMap", false);
   getToken_(puppiInputToken_, _cfg, _coll, "puppiInput", false);
   getToken_(puppiNoLepMapToken_, _cfg, _coll, "puppiNoLepMap", false);
   getToken_(puppiNoLepInputToken_, _cfg, _coll, "puppiNoLepInput", false);
   getToken_(verticesToken_, _cfg, _coll, "common", "vertices");
+
+  registerObjectMap_(pfMap_);
+  registerObjectMap_(puppiMap_, "puppi");
+  consumesObjectMap_(vtxMap_, "vertices");
 }
 
 void
@@ -25,11 +98,18 @@ PFCandsFiller::branchNames(suep::utils::BranchList& _eventBranches, suep::utils:
   _eventBranches.emplace_back("tracks");
 }
 
+void
+PFCandsFiller::setBookedBranches(suep::utils::BranchList const& _eventBranches, suep::utils::BranchList const&)
+{
+  fillTracks_ = isBooked_(_eventBranches, "tracks");
+}
+
 void
 PFCandsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventSetup const&)
 {
   edm::Handle<reco::CandidateView> candsHandle;
   auto& inCands(getProduct_(_inEvent, candidatesToken_, &candsHandle));
+  auto& candSnapshot(getPFCandidateSnapshot_(inCands));
   auto& inVertices(getProduct_(_inEvent, verticesToken_));
 
   // connect inCands and the puppi candidates by references to the base collection
@@ -40,159 +120,212 @@ PFCandsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
   //   edm::Ref<View>(viewHandle, iview) maps to a puppi candidate via puppiMap
   //   View::refAt(iview).key() is the index of the PF candidate in the original collection
 
-  std::map<reco::CandidatePtr, reco::Candidate const*> inCandsMap;
-
-  std::map<reco::Candidate const*, reco::CandidatePtr> puppiPtrMap;
-
-  if (!puppiMapToken_.second.isUninitialized()) {
-    for (unsigned iC(0); iC != inCands.size(); ++iC) {
-      auto ptrToPF(inCands.ptrAt(iC)); // returns a pointer to the original collection (as opposed to Ref<CandidateView> ref(candsHandle, iC));
-      inCandsMap[ptrToPF] = &inCands.at(iC);
-    }
-
-    auto& puppiMap(getProduct_(_inEvent, puppiMapToken_));
-    edm::Handle<reco::CandidateView> puppiInputHandle;
-    auto& puppiInput(getProduct_(_inEvent, puppiInputToken_, &puppiInputHandle));
-    for (unsigned iC(0); iC != puppiInput.size(); ++iC) {
-      edm::Ref<reco::CandidateView> inputRef(puppiInputHandle, iC);
-      auto& puppiPtr(puppiMap[inputRef]);
-
-      auto ptrToPF(puppiInput.ptrAt(iC));
-      auto inCandsItr(inCandsMap.find(ptrToPF));
-      if (inCandsItr == inCandsMap.end()) {
-        // You are here because of a misconfiguration or because the input to puppi had some layer(s) of PF candidate cloning.
-        // It may be possible to trace back to the original PF collection through calls to sourceCandidatePtr()
-        // but for now we don't need to implement it.
-        throw std::runtime_error("Cannot find candidate matching a puppi input");
-      }
-
-      puppiPtrMap[inCandsItr->second] = puppiPtr;
-    }
-  }
+  // Associations are stored in arrays aligned with inCands. The puppi inputs are matched to inCands
+  // through the keys of their ptrs to the base collection.
+  ScratchVector<int> keyToIndex(getArena_()); // base collection key -> index in inCands
+  edm::ProductID baseId;
 
-  std::map<reco::Candidate const*, reco::CandidatePtr> puppiNoLepPtrMap;
+  auto indexKeys([&inCands, &keyToIndex, &baseId]() {
+      if (!keyToIndex.empty() || inCands.size() == 0)
+        return;
 
-  if (!puppiNoLepMapToken_.second.isUninitialized()) {
-    if (inCandsMap.empty()) {
+      keyToIndex.reserve(inCands.size()); // typically key == index
+      baseId = inCands.ptrAt(0).id();
       for (unsigned iC(0); iC != inCands.size(); ++iC) {
         auto ptrToPF(inCands.ptrAt(iC)); // returns a pointer to the original collection (as opposed to Ref<CandidateView> ref(candsHandle, iC));
-        inCandsMap[ptrToPF] = &inCands.at(iC);
+        if (ptrToPF.id() != baseId)
+          throw std::runtime_error("PF candidates from multiple collections");
+        if (ptrToPF.key() >= keyToIndex.size())
+          keyToIndex.resize(ptrToPF.key() + 1, -1);
+        keyToIndex[ptrToPF.key()] = iC;
       }
-    }
+    });
+
+  auto associate([this, &_inEvent, &inCands, &keyToIndex, &baseId](NamedToken<CandidatePtrMap> const& _mapToken, NamedToken<reco::CandidateView> const& _inputToken, ScratchVector<reco::CandidatePtr>& _ptrs) {
+      _ptrs.assign(inCands.size(), reco::CandidatePtr());
+
+      auto& ptrMap(this->getProduct_(_inEvent, _mapToken));
+      edm::Handle<reco::CandidateView> inputHandle;
+      auto& input(this->getProduct_(_inEvent, _inputToken, &inputHandle));
+      for (unsigned iC(0); iC != input.size(); ++iC) {
+        edm::Ref<reco::CandidateView> inputRef(inputHandle, iC);
+
+        auto ptrToPF(input.ptrAt(iC));
+        if (ptrToPF.id() != baseId || ptrToPF.key() >= keyToIndex.size() || keyToIndex[ptrToPF.key()] < 0) {
+          // You are here because of a misconfiguration or because the input to puppi had some layer(s) of PF candidate cloning.
+          // It may be possible to trace back to the original PF collection through calls to sourceCandidatePtr()
+          // but for now we don't need to implement it.
+          throw std::runtime_error("Cannot find candidate matching a " + _mapToken.first + " input");
+        }
 
-    auto& puppiNoLepMap(getProduct_(_inEvent, puppiNoLepMapToken_));
-    edm::Handle<reco::CandidateView> puppiNoLepInputHandle;
-    auto& puppiNoLepInput(getProduct_(_inEvent, puppiNoLepInputToken_, &puppiNoLepInputHandle));
-    for (unsigned iC(0); iC != puppiNoLepInput.size(); ++iC) {
-      edm::Ref<reco::CandidateView> inputRef(puppiNoLepInputHandle, iC);
-      auto& puppiNoLepPtr(puppiNoLepMap[inputRef]);
-
-      auto ptrToPF(puppiNoLepInput.ptrAt(iC));
-      auto inCandsItr(inCandsMap.find(ptrToPF));
-      if (inCandsItr == inCandsMap.end()) {
-        // See above
-        throw std::runtime_error("Cannot find candidate matching a puppiNoLep input");
+        _ptrs[keyToIndex[ptrToPF.key()]] = ptrMap[inputRef];
       }
+    });
 
-      puppiNoLepPtrMap[inCandsItr->second] = puppiNoLepPtr;
-    }
+  // puppi candidate of each input candidate (null if none); empty if no puppi map is given
+  ScratchVector<reco::CandidatePtr> puppiPtrs(getArena_());
+
+  if (!puppiMapToken_.second.isUninitialized()) {
+    indexKeys();
+    associate(puppiMapToken_, puppiInputToken_, puppiPtrs);
   }
 
-  auto& outCands(_outEvent.pfCandidates);
+  ScratchVector<reco::CandidatePtr> puppiNoLepPtrs(getArena_());
 
-  std::vector<reco::CandidatePtr> ptrList;
+  if (!puppiNoLepMapToken_.second.isUninitialized()) {
+    indexKeys();
+    associate(puppiNoLepMapToken_, puppiNoLepInputToken_, puppiNoLepPtrs);
+  }
 
-  unsigned iP(-1);
-  for (auto& inCand : inCands) {
-    ++iP;
+  // Stage the output values in arrays aligned with inCands, together with the sort key (vertex, -pt)
+  unsigned nCands(inCands.size());
 
-    auto* inPacked(dynamic_cast<pat::PackedCandidate const*>(&inCand));
+  ScratchVector<uint16_t> packedPt(nCands, getArena_());
+  ScratchVector<uint16_t> packedEta(nCands, getArena_());
+  ScratchVector<uint16_t> packedPhi(nCands, getArena_());
+  ScratchVector<uint16_t> packedM(nCands, getArena_());
+  ScratchVector<double> puppiW(nCands, getArena_());
+  ScratchVector<double> puppiWNoLep(nCands, getArena_());
+  ScratchVector<unsigned char> ptypes(nCands, getArena_());
+  ScratchVector<uint64_t> sortKeys(nCands, getArena_());
+  ScratchVector<bool> keep(nCands, true, getArena_());
 
-    auto& outCand(outCands.create_back());
+  for (unsigned iP(0); iP != nCands; ++iP) {
+    auto& inCand(inCands.at(iP));
+    auto* inPacked(candSnapshot.packed(iP));
 
     if (inPacked) {
       // directly fill the packed values to minimize the precision loss
       PackedPatCandidateExposer exposer(*inPacked);
-      outCand.packedPt = exposer.packedPt();
-      outCand.packedEta = exposer.packedEta();
-      outCand.packedPhi = exposer.packedPhi();
-      outCand.packedM = exposer.packedM();
+      packedPt[iP] = exposer.packedPt();
+      packedEta[iP] = exposer.packedEta();
+      packedPhi[iP] = exposer.packedPhi();
+      packedM[iP] = exposer.packedM();
       if (useExistingWeights_) {
         // Except for PUPPI weights, which have changed in 10_2_4, unfortunately
-        outCand.setPuppiW(inPacked->puppiWeight(), inPacked->puppiWeightNoLep());
+        puppiW[iP] = inPacked->puppiWeight();
+        puppiWNoLep[iP] = inPacked->puppiWeightNoLep();
       }
-
-      auto vtxRef(inPacked->vertexRef());
-      if (vtxRef.isNonnull())
-        outCand.vertex.idx() = vtxRef.key();
-      else // in reality this seems to never happen
-        outCand.vertex.idx() = -1;
-    }
-    else {
-      fillP4(outCand, inCand);
-      outCand.vertex.idx() = -1;
     }
 
     // if puppi collection is given, use its weight
     if (!useExistingWeights_) {
-      double puppiW(-1.);
-      double puppiWNoLep(-1.);
-
-      if (!puppiPtrMap.empty()) {
-        auto&& ppItr(puppiPtrMap.find(&inCand));
-        if (ppItr != puppiPtrMap.end() && ppItr->second.isNonnull())
-          puppiW = ppItr->second->pt() / inCand.pt();
-      }
+      puppiW[iP] = -1.;
+      puppiWNoLep[iP] = -1.;
 
-      if (!puppiNoLepPtrMap.empty()) {
-        auto&& ppItr(puppiNoLepPtrMap.find(&inCand));
-        if (ppItr != puppiNoLepPtrMap.end() && ppItr->second.isNonnull())
-          puppiWNoLep = ppItr->second->pt() / inCand.pt();
-      }
+      if (!puppiPtrs.empty() && puppiPtrs[iP].isNonnull())
+        puppiW[iP] = puppiPtrs[iP]->pt() / inCand.pt();
 
-      outCand.setPuppiW(puppiW, puppiWNoLep);
+      if (!puppiNoLepPtrs.empty() && puppiNoLepPtrs[iP].isNonnull())
+        puppiWNoLep[iP] = puppiNoLepPtrs[iP]->pt() / inCand.pt();
     }
 
-    outCand.ptype = suep::PFCand::X;
+    ptypes[iP] = suep::PFCand::X;
     unsigned ptype(0);
     while (ptype != suep::PFCand::nPTypes) {
-      if (suep::PFCand::pdgId_[ptype] == inCand.pdgId()) {
-        outCand.ptype = ptype;
+      if (suep::PFCand::pdgId_[ptype] == candSnapshot.pdgId(iP)) {
+        ptypes[iP] = ptype;
         break;
       }
       ++ptype;
     }
 
-    outCand.hCalFrac = inPacked->hcalFraction();
+    // candidates without a vertex (-1) go last
+    sortKeys[iP] = sortKey(candSnapshot.vertexKey(iP), candSnapshot.pt(iP));
+
+    if (thinning_) {
+      auto mItr(minPtByPdgId_.find(std::abs(candSnapshot.pdgId(iP))));
+      double minPt(mItr == minPtByPdgId_.end() ? defaultMinPt_ : mItr->second);
 
-    ptrList.push_back(inCands.ptrAt(iP));
+      keep[iP] = candSnapshot.pt(iP) > minPt && puppiW[iP] >= minPuppiWeight_;
+
+      if (keep[iP] && minChargedFromPV_ > 0 && candSnapshot.charge(iP) != 0)
+        keep[iP] = inPacked && inPacked->fromPV() >= minChargedFromPV_;
+    }
   }
 
-  auto ByVertexAndPt([](suep::Element const& e1, suep::Element const& e2)->Bool_t {
-      auto& p1(static_cast<suep::PFCand const&>(e1));
-      auto& p2(static_cast<suep::PFCand const&>(e2));
-      if (p1.vertex.idx() == p2.vertex.idx())
-        return p1.pt() > p2.pt();
-      else
-        return unsigned(p1.vertex.idx()) < unsigned(p2.vertex.idx());
-    });
+  // candidates referenced by other objects are kept regardless of the cuts
+  if (thinning_ && !keepReferencedByTokens_.empty()) {
+    indexKeys();
+
+    auto keepPtr([&keep, &keyToIndex, &baseId](reco::CandidatePtr _ptr) {
+        // follow the chain of clones (e.g. puppi-weighted candidates) down to the PF collection
+        while (_ptr.isNonnull() && _ptr.id() != baseId) {
+          if (!_ptr.isAvailable() || _ptr->numberOfSourceCandidatePtrs() == 0)
+            return;
+          _ptr = _ptr->sourceCandidatePtr(0);
+        }
+
+        if (_ptr.isNonnull() && _ptr.key() < keyToIndex.size() && keyToIndex[_ptr.key()] >= 0)
+          keep[keyToIndex[_ptr.key()]] = true;
+      });
 
-  // sort the output electrons
-  auto originalIndices(outCands.sort(ByVertexAndPt));
-
-  // make reco <-> suep mapping
-  auto& objectMap(objectMap_->get<reco::Candidate, suep::PFCand>());
-  auto& puppiMap(objectMap_->get<reco::Candidate, suep::PFCand>("puppi"));
-  
-  for (unsigned iP(0); iP != outCands.size(); ++iP) {
-    auto& outCand(outCands[iP]);
-    unsigned idx(originalIndices[iP]);
-    auto& ptr(ptrList[idx]);
+    for (auto& token : keepReferencedByTokens_) {
+      for (auto& obj : getProduct_(_inEvent, token)) {
+        for (unsigned iD(0); iD != obj.numberOfDaughters(); ++iD)
+          keepPtr(obj.daughterPtr(iD));
+        for (unsigned iS(0); iS != obj.numberOfSourceCandidatePtrs(); ++iS)
+          keepPtr(obj.sourceCandidatePtr(iS));
+      }
+    }
+  }
+
+  ScratchVector<unsigned> order(getArena_());
+  ScratchVector<unsigned> radixBuffer(getArena_());
+  radixSort(sortKeys, order, radixBuffer);
+
+  // Emit the output in one pass: candidates, reco <-> suep mapping, tracks, and the per-vertex ranges
+  auto& outCands(_outEvent.pfCandidates);
+  auto& objectMap(*pfMap_);
+  auto& puppiMap(*puppiMap_);
+
+  outCands.reserve(nCands);
+
+  pfRangeMax_.assign(inVertices.size(), 0);
+
+  for (unsigned idx : order) {
+    if (!keep[idx])
+      continue;
+
+    auto& inCand(inCands.at(idx));
+    auto* inPacked(candSnapshot.packed(idx));
+    int vertexKey(candSnapshot.vertexKey(idx));
+
+    auto& outCand(outCands.create_back());
+
+    if (inPacked) {
+      outCand.packedPt = packedPt[idx];
+      outCand.packedEta = packedEta[idx];
+      outCand.packedPhi = packedPhi[idx];
+      outCand.packedM = packedM[idx];
+      // -1 if there is no vertex (in reality this seems to never happen)
+      outCand.vertex.idx() = vertexKey;
+    }
+    else {
+      fillP4(outCand, inCand);
+      outCand.vertex.idx() = -1;
+      vertexKey = -1;
+    }
+
+    if (inPacked || !useExistingWeights_)
+      outCand.setPuppiW(puppiW[idx], puppiWNoLep[idx]);
+
+    outCand.ptype = ptypes[idx];
+
+    outCand.hCalFrac = inPacked->hcalFraction();
+
+    // pfRangeMax of a vertex is the end of its candidate range; vertices are in increasing key order
+    if (vertexKey >= 0 && unsigned(vertexKey) < pfRangeMax_.size())
+      ++pfRangeMax_[vertexKey];
+
+    auto ptr(inCands.ptrAt(idx));
     objectMap.add(ptr, outCand);
 
-    auto&& ppItr(puppiPtrMap.find(ptr.get()));
-    if (ppItr != puppiPtrMap.end() && ppItr->second.isNonnull())
-      puppiMap.add(ppItr->second, outCand);
+    if (!puppiPtrs.empty() && puppiPtrs[idx].isNonnull())
+      puppiMap.add(puppiPtrs[idx], outCand);
+
+    if (!fillTracks_)
+      continue;
 
     // add track information for charged hadrons
     // track order matters; track ref from PFCand are set during Event::getEntry relying on the order
@@ -205,9 +338,9 @@ PFCandsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
     case suep::PFCand::mum:
       {
         auto& track(_outEvent.tracks.create_back());
-        PackedPatCandidateExposer exposer(static_cast<pat::PackedCandidate const&>(*ptr));
+        PackedPatCandidateExposer exposer(static_cast<pat::PackedCandidate const&>(inCand));
 
-        auto* bestTrack(ptr->bestTrack());
+        auto* bestTrack(inCand.bestTrack());
         if (bestTrack) {
           track.setPtError(bestTrack->ptError());
           // Only highPurity is filled in miniAOD, see https://twiki.cern.ch/twiki/bin/view/CMSPublic/WorkBookTrackAnalysis
@@ -223,7 +356,9 @@ PFCandsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
     }
   }
 
-  outCandidates_ = &outCands;
+  // cumulative counts
+  for (unsigned iV(1); iV < pfRangeMax_.size(); ++iV)
+    pfRangeMax_[iV] += pfRangeMax_[iV - 1];
 
   orderedVertices_.resize(inVertices.size());
   for (unsigned iV(0); iV != inVertices.size(); ++iV)
@@ -231,32 +366,13 @@ PFCandsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
 }
 
 void
-PFCandsFiller::setRefs(ObjectMapStore const& _objectMaps)
+PFCandsFiller::setRefs(ObjectMapStore const&)
 {
-  auto& vtxMap(_objectMaps.at("vertices").get<reco::Vertex, suep::RecoVertex>().fwdMap);
-
-  unsigned nVtx(orderedVertices_.size());
-
-  unsigned iVtx(0);
-  unsigned iPF(0);
-  for (auto& cand : *outCandidates_) {
-    unsigned idx(cand.vertex.idx());
-
-    while (idx != iVtx && iVtx != nVtx) { // first candidate of the next vertex
-      vtxMap.at(orderedVertices_[iVtx])->pfRangeMax = iPF;
-      ++iVtx;
-    }
+  // ranges are computed in fill(); the vertices are only reachable now
+  auto& vtxMap(*vtxMap_);
 
-    if (iVtx == nVtx)
-      break;
-
-    ++iPF;
-  }
-
-  while (iVtx != nVtx) {
-    vtxMap.at(orderedVertices_[iVtx])->pfRangeMax = iPF;
-    ++iVtx;
-  }
+  for (unsigned iV(0); iV != orderedVertices_.size(); ++iV)
+    vtxMap.at(orderedVertices_[iV])->pfRangeMax = pfRangeMax_[iV];
 }
 
 DEFINE_TREEFILLER(PFCandsFiller);
@@ -8,9 +8,9 @@
 #include "DataFormats/EgammaCandidates/interface/GsfElectron.h"
 #include "DataFormats/PatCandidates/interface/Photon.h"
 #include "DataFormats/Common/interface/RefToPtr.h"
-#include "DataFormats/Math/interface/deltaR.h"
 
 #include <cmath>
+#include <memory>
 
 PhotonsFiller::PhotonsFiller(std::string const& _name, edm::ParameterSet const& _cfg, edm::ConsumesCollector& _coll) :
   FillerBase(_name, _cfg),
@@ -39,6 +39,16 @@ PhotonsFiller::PhotonsFiller(std::string const& _name, edm::ParameterSet const&
   nhIsoLeakage_[1].Compile(getParameter_<std::string>(_cfg, "nhIsoLeakage.EE", "").c_str());
   phIsoLeakage_[0].Compile(getParameter_<std::string>(_cfg, "phIsoLeakage.EB", "").c_str());
   phIsoLeakage_[1].Compile(getParameter_<std::string>(_cfg, "phIsoLeakage.EE", "").c_str());
+
+  registerObjectMap_(phoPhoMap_);
+  registerObjectMap_(scPhoMap_);
+  registerObjectMap_(pfPhoMap_, "pf");
+  registerObjectMap_(genPhoMap_, "gen");
+
+  consumesObjectMap_(scMap_, "superClusters");
+  consumesObjectMap_(pfMap_, "pfCandidates");
+  if (!isRealData_)
+    consumesObjectMap_(genMap_, "genParticles");
 }
 
 void
@@ -82,21 +92,14 @@ PhotonsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
       return &*hitItr;
     });
 
-  auto findPF([&pfCandidates](reco::Photon const& inPhoton)->reco::CandidatePtr {
-      int iMatch(-1);
-
-      double minDR(0.1);
-      for (unsigned iPF(0); iPF != pfCandidates.size(); ++iPF) {
-        auto& pf(pfCandidates.at(iPF));
-        if (std::abs(pf.pdgId()) != 11 || pf.pdgId() == 22)
-          continue;
+  auto& candSnapshot(getPFCandidateSnapshot_(pfCandidates));
+  auto& pfIndex(getPFCandidateIndex_(pfCandidates));
 
-        double dR(reco::deltaR(pf, inPhoton));
-        if (dR < minDR) {
-          minDR = dR;
-          iMatch = iPF;
-        }
-      }
+  auto findPF([&pfCandidates, &candSnapshot, &pfIndex](reco::Photon const& inPhoton)->reco::CandidatePtr {
+      // closest PF electron within dR < 0.1
+      int iMatch(pfIndex.nearest(inPhoton.eta(), inPhoton.phi(), 0.1, [&candSnapshot](unsigned iPF) {
+            return std::abs(candSnapshot.pdgId(iPF)) == 11;
+          }));
 
       if (iMatch >= 0)
         return pfCandidates.ptrAt(iMatch);
@@ -104,13 +107,13 @@ PhotonsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
         return reco::CandidatePtr();
     });
 
-  std::vector<reco::Candidate const*> chargedPFCandidates;
-  for (auto& cand : pfCandidates) {
-    if (cand.charge() != 0)
-      chargedPFCandidates.emplace_back(&cand);
+  std::unique_ptr<noZS::EcalClusterLazyTools> lazyToolsPtr;
+  {
+    // lazy tools read the event and the event setup at construction
+    auto lock(lockFramework_());
+    lazyToolsPtr.reset(new noZS::EcalClusterLazyTools(_inEvent, _setup, ebHitsToken_.second, eeHitsToken_.second));
   }
-
-  noZS::EcalClusterLazyTools lazyTools(_inEvent, _setup, ebHitsToken_.second, eeHitsToken_.second);
+  auto& lazyTools(*lazyToolsPtr);
 
   auto& outPhotons(_outEvent.photons);
 
@@ -188,15 +191,10 @@ PhotonsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
       outPhoton.csafeVeto = static_cast<pat::Photon const&>(inPhoton).passElectronVeto();
 
     outPhoton.pfchVeto = true;
-    for (auto* cand : chargedPFCandidates) {
-      if (reco::deltaR(*cand, inPhoton) > 0.1)
-        continue;
-
-      if (cand->pt() / scRawPt > 0.6) {
-        outPhoton.pfchVeto = false;
-        break;
-      }
-    }
+    pfIndex.forEachInCone(inPhoton.eta(), inPhoton.phi(), 0.1, [&](unsigned iPF, double) {
+        if (candSnapshot.charge(iPF) != 0 && candSnapshot.pt(iPF) / scRawPt > 0.6)
+          outPhoton.pfchVeto = false;
+      });
 
     outPhoton.mipEnergy = inPhoton.mipTotEnergy();
 
@@ -278,10 +276,10 @@ PhotonsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
   auto originalIndices(outPhotons.sort(suep::Particle::PtGreater));
 
   // make reco <-> suep mapping
-  auto& phoPhoMap(objectMap_->get<reco::Photon, suep::Photon>());
-  auto& scPhoMap(objectMap_->get<reco::SuperCluster, suep::Photon>());
-  auto& pfPhoMap(objectMap_->get<reco::Candidate, suep::Photon>("pf"));
-  auto& genPhoMap(objectMap_->get<reco::Candidate, suep::Photon>("gen"));
+  auto& phoPhoMap(*phoPhoMap_);
+  auto& scPhoMap(*scPhoMap_);
+  auto& pfPhoMap(*pfPhoMap_);
+  auto& genPhoMap(*genPhoMap_);
   
   for (unsigned iP(0); iP != outPhotons.size(); ++iP) {
     auto& outPhoton(outPhotons[iP]);
@@ -308,40 +306,44 @@ PhotonsFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Eve
 }
 
 void
-PhotonsFiller::setRefs(ObjectMapStore const& _objectMaps)
+PhotonsFiller::setRefs(ObjectMapStore const&)
 {
-  auto& scPhoMap(objectMap_->get<reco::SuperCluster, suep::Photon>().bwdMap);
-  auto& pfPhoMap(objectMap_->get<reco::Candidate, suep::Photon>("pf"));
+  auto& scPhoMap(*scPhoMap_);
+  auto& pfPhoMap(*pfPhoMap_);
 
-  auto& scMap(_objectMaps.at("superClusters").get<reco::SuperCluster, suep::SuperCluster>().fwdMap);
-  auto& pfMap(_objectMaps.at("pfCandidates").get<reco::Candidate, suep::PFCand>().fwdMap);
+  auto& scMap(*scMap_);
+  auto& pfMap(*pfMap_);
 
   for (auto& link : scPhoMap) { // suep -> edm
-    auto& outPhoton(*link.first);
-    auto& scPtr(link.second);
+    auto& outPhoton(*link.suepObj);
+    auto& scPtr(link.edmPtr);
 
     outPhoton.superCluster.setRef(scMap.at(scPtr));
   }
 
-  for (auto& link : pfPhoMap.bwdMap) { // suep -> edm
-    auto& outPhoton(*link.first);
-    auto& pfPtr(link.second);
+  for (auto& link : pfPhoMap) { // suep -> edm
+    auto& outPhoton(*link.suepObj);
+    auto& pfPtr(link.edmPtr);
 
-    outPhoton.matchedPF.setRef(pfMap.at(pfPtr));
+    // may be missing if the PF candidates are thinned
+    auto* outPF(pfMap.find(pfPtr));
+    if (outPF)
+      outPhoton.matchedPF.setRef(outPF);
   }
 
   if (!isRealData_) {
-    auto& genPhoMap(objectMap_->get<reco::Candidate, suep::Photon>("gen"));
+    auto& genPhoMap(*genPhoMap_);
 
-    auto& genMap(_objectMaps.at("genParticles").get<reco::Candidate, suep::GenParticle>().fwdMap);
+    auto& genMap(*genMap_);
 
-    for (auto& link : genPhoMap.bwdMap) {
-      auto& genPtr(link.second);
-      if (genMap.find(genPtr) == genMap.end())
+    for (auto& link : genPhoMap) {
+      auto& genPtr(link.edmPtr);
+      auto* outGen(genMap.find(genPtr));
+      if (!outGen)
         continue;
 
-      auto& outPhoton(*link.first);
-      outPhoton.matchedGen.setRef(genMap.at(genPtr));
+      auto& outPhoton(*link.suepObj);
+      outPhoton.matchedGen.setRef(outGen);
     }
   }
 }
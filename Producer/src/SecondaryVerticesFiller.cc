@@ -11,6 +11,10 @@ SecondaryVerticesFiller::SecondaryVerticesFiller(std::string const& _name, edm::
   // These are different from VerticesFiller
   getToken_(secondaryVerticesToken_, _cfg, _coll, "source");
 
+  registerObjectMap_(svMap_);
+  consumesObjectMap_(pfCandMap_, "pfCandidates");
+  consumesObjectMap_(pvMap_, "vertices");
+
 }
 
 void
@@ -26,7 +30,7 @@ SecondaryVerticesFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent
   auto& inSVs(getProduct_(_inEvent, secondaryVerticesToken_));
   auto& outSVs(_outEvent.secondaryVertices);
 
-  auto& objMap(objectMap_->get<reco::VertexCompositePtrCandidate, suep::SecondaryVertex>());
+  auto& objMap(*svMap_);
 
   unsigned iVtx(0);
   for (auto& inSV : inSVs) {
@@ -50,26 +54,26 @@ SecondaryVerticesFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent
 }
 
 void
-SecondaryVerticesFiller::setRefs(ObjectMapStore const& _objectMaps)
+SecondaryVerticesFiller::setRefs(ObjectMapStore const&)
 {
 
   // Link to PFCandidates
 
-  auto& svMap(objectMap_->get<reco::VertexCompositePtrCandidate, suep::SecondaryVertex>().fwdMap);
-  auto& pfCandMap(_objectMaps.at("pfCandidates").get<reco::Candidate, suep::PFCand>().fwdMap);
+  auto& svMap(*svMap_);
+  auto& pfCandMap(*pfCandMap_);
 
   for (auto& svLink : svMap) {
-    auto& inSV(*svLink.first);
-    auto& outSV(*svLink.second);
+    auto& inSV(*svLink.edmPtr);
+    auto& outSV(*svLink.suepObj);
     auto ndaughters(inSV.numberOfDaughters());
 
     for (reco::Candidate::size_type iDaughter = 0; iDaughter < ndaughters; ++iDaughter) {
 
       auto daughterPtr(inSV.daughterPtr(iDaughter));
 
-      auto&& outPFCand(pfCandMap.find(daughterPtr));
-      if (outPFCand != pfCandMap.end())
-        outSV.daughters.addRef(outPFCand->second);
+      auto* outPFCand(pfCandMap.find(daughterPtr));
+      if (outPFCand)
+        outSV.daughters.addRef(outPFCand);
 
     }
   }
@@ -77,16 +81,16 @@ SecondaryVerticesFiller::setRefs(ObjectMapStore const& _objectMaps)
   // Select the primary vertex
 
   float maxScore(0);
-  auto& pvMap(_objectMaps.at("vertices").get<reco::Vertex, suep::RecoVertex>());
+  auto& pvMap(*pvMap_);
   edm::Ptr<reco::Vertex> pv;
 
-  for (auto& vtxLink : pvMap.fwdMap) {
+  for (auto& vtxLink : pvMap) {
 
-    auto outVtx(*vtxLink.second);
+    auto outVtx(*vtxLink.suepObj);
     if (outVtx.score > maxScore) {
 
       maxScore = outVtx.score;
-      pv = vtxLink.first;
+      pv = vtxLink.edmPtr;
 
     }
   }
@@ -95,8 +99,8 @@ SecondaryVerticesFiller::setRefs(ObjectMapStore const& _objectMaps)
   VertexDistance3D vdist;
 
   for (auto& svLink : svMap) {   // edm -> suep
-    auto& inSV(*svLink.first);
-    auto& outSV(*svLink.second);
+    auto& inSV(*svLink.edmPtr);
+    auto& outSV(*svLink.suepObj);
     auto distance(vdist.distance(*pv, VertexState(RecoVertex::convertPos(inSV.position()),
                                                   RecoVertex::convertError(inSV.error())))
                   );
@@ -5,6 +5,7 @@
 #include "DataFormats/EgammaReco/interface/SuperCluster.h"
 
 #include <cmath>
+#include <memory>
 
 SuperClustersFiller::SuperClustersFiller(std::string const& _name, edm::ParameterSet const& _cfg, edm::ConsumesCollector& _coll) :
   FillerBase(_name, _cfg)
@@ -12,6 +13,8 @@ SuperClustersFiller::SuperClustersFiller(std::string const& _name, edm::Paramete
   getToken_(superClustersToken_, _cfg, _coll, "superClusters");
   getToken_(ebHitsToken_, _cfg, _coll, "ebHits");
   getToken_(eeHitsToken_, _cfg, _coll, "eeHits");
+
+  registerObjectMap_(scMap_);
 }
 
 void
@@ -25,12 +28,18 @@ SuperClustersFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, ed
 {
   auto& inSuperClusters(getProduct_(_inEvent, superClustersToken_));
 
-  noZS::EcalClusterLazyTools lazyTools(_inEvent, _setup, ebHitsToken_.second, eeHitsToken_.second);
+  std::unique_ptr<noZS::EcalClusterLazyTools> lazyToolsPtr;
+  {
+    // lazy tools read the event and the event setup at construction
+    auto lock(lockFramework_());
+    lazyToolsPtr.reset(new noZS::EcalClusterLazyTools(_inEvent, _setup, ebHitsToken_.second, eeHitsToken_.second));
+  }
+  auto& lazyTools(*lazyToolsPtr);
 
   auto& outSuperClusters(_outEvent.superClusters);
   outSuperClusters.reserve(inSuperClusters.size());
 
-  auto& objectMap(objectMap_->get<reco::SuperCluster, suep::SuperCluster>());
+  auto& objectMap(*scMap_);
 
   unsigned iSC(-1);
   for (auto& inSC : inSuperClusters) {
@@ -11,6 +11,14 @@ TausFiller::TausFiller(std::string const& _name, edm::ParameterSet const& _cfg,
   getToken_(tausToken_, _cfg, _coll, "taus");
   if (!isRealData_)
     getToken_(genParticlesToken_, _cfg, _coll, "common", "genParticles");
+
+  registerObjectMap_(tauMap_);
+  registerObjectMap_(vtxTauMap_);
+  registerObjectMap_(genTauMap_);
+
+  consumesObjectMap_(vtxMap_, "vertices");
+  if (!isRealData_)
+    consumesObjectMap_(genMap_, "genParticles");
 }
 
 void
@@ -75,9 +83,9 @@ TausFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventS
     }
   } 
 
-  auto& objectMap(objectMap_->get<reco::BaseTau, suep::Tau>());
-  auto& vtxTauMap(objectMap_->get<reco::Vertex, suep::Tau>());
-  auto& genTauMap(objectMap_->get<reco::Candidate, suep::Tau>());
+  auto& objectMap(*tauMap_);
+  auto& vtxTauMap(*vtxTauMap_);
+  auto& genTauMap(*genTauMap_);
 
   for (unsigned iP(0); iP != outTaus.size(); ++iP) {
     auto& outTau(outTaus[iP]);
@@ -106,31 +114,32 @@ TausFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::EventS
 }
 
 void
-TausFiller::setRefs(ObjectMapStore const& _objectMaps)
+TausFiller::setRefs(ObjectMapStore const&)
 {
-  auto& vtxTauMap(objectMap_->get<reco::Vertex, suep::Tau>());
+  auto& vtxTauMap(*vtxTauMap_);
 
-  auto& vtxMap(_objectMaps.at("vertices").get<reco::Vertex, suep::RecoVertex>().fwdMap);
+  auto& vtxMap(*vtxMap_);
 
-  for (auto& link : vtxTauMap.bwdMap) { // suep -> edm
-    auto& outTau(*link.first);
-    auto& vtxPtr(link.second);
+  for (auto& link : vtxTauMap) { // suep -> edm
+    auto& outTau(*link.suepObj);
+    auto& vtxPtr(link.edmPtr);
 
     outTau.vertex.setRef(vtxMap.at(vtxPtr));
   }
 
   if (!isRealData_) {
-    auto& genTauMap(objectMap_->get<reco::Candidate, suep::Tau>());
+    auto& genTauMap(*genTauMap_);
 
-    auto& genMap(_objectMaps.at("genParticles").get<reco::Candidate, suep::GenParticle>().fwdMap);
+    auto& genMap(*genMap_);
 
-    for (auto& link : genTauMap.bwdMap) {
-      auto& genPtr(link.second);
-      if (genMap.find(genPtr) == genMap.end())
+    for (auto& link : genTauMap) {
+      auto& genPtr(link.edmPtr);
+      auto* outGen(genMap.find(genPtr));
+      if (!outGen)
         continue;
 
-      auto& outTau(*link.first);
-      outTau.matchedGen.setRef(genMap.at(genPtr));
+      auto& outTau(*link.suepObj);
+      outTau.matchedGen.setRef(outGen);
     }
   }
 }
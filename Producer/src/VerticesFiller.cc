@@ -49,20 +49,12 @@ VerticesFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Ev
   auto& outVertices(_outEvent.vertices);
   outVertices.reserve(inVertices.size());
 
-  auto& objMap(objectMap_->get<reco::Vertex, suep::RecoVertex>());
+  auto& objMap(*vtxMap_);
 
   _outEvent.npv = npvCache_;
 
-  // if MINIAOD
-  std::vector<unsigned> ntrkCounters(inVertices.size(), 0);
-  for (auto& cand : inCandidates) {
-    auto* inPacked(dynamic_cast<pat::PackedCandidate const*>(&cand));
-    if (inPacked) {
-      auto&& vtxRef(inPacked->vertexRef());
-      if (vtxRef.isNonnull())
-        ntrkCounters.at(vtxRef.key()) += 1;
-    }
-  }
+  // if MINIAOD: candidates per vertex are counted in the shared pass over the candidates
+  auto& candSnapshot(getPFCandidateSnapshot_(inCandidates));
 
   unsigned iVtx(0);
   for (auto& inVtx : inVertices) {
@@ -79,7 +71,7 @@ VerticesFiller::fill(suep::Event& _outEvent, edm::Event const& _inEvent, edm::Ev
     // if AOD
     // outVtx.ntrk = inVtx.tracksSize();
     // if MINIAOD
-    outVtx.ntrk = ntrkCounters[iVtx];
+    outVtx.ntrk = candSnapshot.nCandidates(iVtx);
 
     objMap.add(ptr, outVtx);
 
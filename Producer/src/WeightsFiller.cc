@@ -1,4 +1,5 @@
 #include "../interface/WeightsFiller.h"
+#include "../interface/EventWriter.h"
 
 #include "FWCore/Framework/interface/Run.h"
 
@@ -11,7 +12,8 @@
 auto GetAll([](edm::BranchDescription const&)->bool { return true; });
 
 WeightsFiller::WeightsFiller(std::string const& _name, edm::ParameterSet const& _cfg, edm::ConsumesCollector& _coll) :
-  FillerBase(_name, _cfg)
+  FillerBase(_name, _cfg),
+  saveGenParam_(!isRealData_ && getParameter_<bool>(_cfg, "genParam", true))
 {
   if (!isRealData_) {
     getToken_(genInfoToken_, _cfg, _coll, "common", "genEventInfo");
@@ -42,13 +44,25 @@ WeightsFiller::WeightsFiller(std::string const& _name, edm::ParameterSet const&
   }
 }
 
+void
+WeightsFiller::setEventWriters(std::vector<EventWriter*> const& _writers)
+{
+  writers_ = _writers;
+
+  // without an LHEEventProduct, there is no learning phase and no genParam
+  if (saveGenParam_ && !lheEventToken_.second.isUninitialized()) {
+    for (auto* writer : writers_)
+      writer->expectGenParam();
+  }
+}
+
 void
 WeightsFiller::branchNames(suep::utils::BranchList& _eventBranches, suep::utils::BranchList&) const
 {
   _eventBranches.emplace_back("weight");
   if (!isRealData_) {
     _eventBranches.emplace_back("genReweight");
-    // genParam is booked at the first encounter
+    // genParam is booked by the writers at the end of the learning phase
     _eventBranches.push_back("!genReweight.genParam");
   }
 }
@@ -72,10 +86,15 @@ WeightsFiller::addOutput(TFile& _outputFile)
     for (unsigned iP(1); iP <= nPDFVar; ++iP)
       labels.emplace_back(TString::Format("pdf%d", iP));
 
+    // signal weights learned before an output rollover
+    if (!wids_.empty()) {
+      unsigned nbinsx(hSumW_->GetNbinsX() + wids_.size());
+      hSumW_->SetBins(nbinsx, 0., nbinsx);
+      labels.insert(labels.end(), wids_.begin(), wids_.end());
+    }
+
     for (unsigned iL(0); iL != labels.size(); ++iL)
       hSumW_->GetXaxis()->SetBinLabel(iL + 2, labels[iL]);
-
-    outputFile_ = &_outputFile;
   }
 }
 
@@ -124,7 +143,7 @@ WeightsFiller::fill(suep::Event& _outEvent, edm::Event const&, edm::EventSetup c
 
   _outEvent.weight = central_;
 
-  if (bufferCounter_ == 0) // getLHEWeights was not called
+  if (learningCounter_ == 0) // getLHEWeights was not called
     return;
 
   // Save the offset of normalized reweight factor from 1 for precision
@@ -140,22 +159,36 @@ WeightsFiller::fill(suep::Event& _outEvent, edm::Event const&, edm::EventSetup c
   for (unsigned iW(0); iW != nPDFVar; ++iW)
     _outEvent.genReweight.pdfAltDW[iW] = normPDFVariations_[iW] - 1.;
 
-  // genParam branch is not filled from the outEvent object, but we copy the value here for consistence
-  // (some other filler module may decide to use the values!)
+  // The writers fill the genParam branch from the event. The whole array is copied because another
+  // stream may have learned more signal weights than this one (the values are -1 beyond ours).
   // Unlike QCD variation reweights, genParam can represent anything and is not guaranteed to cluster around 1.
   // Therefore we save the normalized weights directly and do not subtract 1.
-  std::copy(genParam_, genParam_ + wids_.size(), _outEvent.genReweight.genParam);
+  std::copy(genParam_, genParam_ + suep::GenReweight::NMAX, _outEvent.genReweight.genParam);
 }
 
 void
 WeightsFiller::fillEndRun(suep::Run&, edm::Run const&, edm::EventSetup const&)
 {
-  if (!isRealData_ && bufferCounter_ < learningPhase) {
-    // Run boundary before getting out of learning phase
-    // It could be a genuine run boundary, but there is no way to tell -> we need to exit learning phase now
-    bookGenParam_();
+  // Run boundary before getting out of learning phase
+  // It could be a genuine run boundary, but there is no way to tell -> we need to exit learning phase now
+  endLearningPhase_();
+}
+
+void
+WeightsFiller::beforeRollover(suep::Run&)
+{
+  // genParam of the events in the closing file must be written now
+  endLearningPhase_();
+}
+
+void
+WeightsFiller::endLearningPhase_()
+{
+  // A stream that has not seen any event yet leaves the learning to the others
+  if (!isRealData_ && learningCounter_ != 0 && learningCounter_ <= learningPhase) {
+    setGenParamIds_();
 
-    bufferCounter_ = 0xffffffff;
+    learningCounter_ = 0xffffffff;
   }
 }
 
@@ -187,9 +220,11 @@ WeightsFiller::getLHEWeights_(LHEEventProduct const& _lheEvent)
     }
     catch (std::invalid_argument& ex) {
       // assumption: this is signal reweights
+      if (!saveGenParam_)
+        continue;
 
       if (iS >= wids_.size()) {
-        if (bufferCounter_ < learningPhase) {
+        if (learningCounter_ < learningPhase) {
           // assumption: weights always come in the same order, but the list can be truncated
           wids_.emplace_back(wgt.id);
 
@@ -240,42 +275,24 @@ WeightsFiller::getLHEWeights_(LHEEventProduct const& _lheEvent)
       normPDFVariations_[id - pdfBegin_] = wgt.wgt / lheCentral;
   }
 
-  if (bufferCounter_ < learningPhase) {
-    // save the weights to the buffer
-    std::copy(genParam_, genParam_ + iS, genParamBuffer_[bufferCounter_]);
-    ++bufferCounter_;
-  }
-  else if (bufferCounter_ == learningPhase) {
+  if (learningCounter_ < learningPhase)
+    ++learningCounter_;
+  else if (learningCounter_ == learningPhase) {
     // By now we should know how large the signal weights vector is
-    bookGenParam_();
-    bufferCounter_ = 0xffffffff;
+    setGenParamIds_();
+    learningCounter_ = 0xffffffff;
   }
 }
 
 void
-WeightsFiller::bookGenParam_()
+WeightsFiller::setGenParamIds_()
 {
-  if (wids_.size() == 0)
+  if (!saveGenParam_)
     return;
 
-  TDirectory::TContext context(outputFile_);
-
-  auto* weightTree(new TTree("weights", "weights"));
-  auto* wid(new TString);
-  weightTree->Branch("id", "TString", &wid); // currently only have the ability to save ID
-
-  for (TString& w : wids_) {
-    *wid = w;
-    weightTree->Fill();
-  }
-
-  auto* eventTree(static_cast<TTree*>(outputFile_->Get("events")));
-  auto* branch(eventTree->Branch("genReweight.genParam", genParam_, TString::Format("genParam[%d]/F", int(wids_.size()))));
-
-  for (unsigned iE(0); iE != learningPhase; ++iE) {
-    std::copy(genParamBuffer_[iE], genParamBuffer_[iE] + wids_.size(), genParam_);
-    branch->Fill();
-  }
+  // The writers book the genParam branch and backfill the events written during the learning phase
+  for (auto* writer : writers_)
+    writer->setGenParamIds(wids_);
 }
 
 DEFINE_TREEFILLER(WeightsFiller);
@@ -0,0 +1,126 @@
+#ifndef SUEPProd_Utilities_EtaPhiGrid_h
+#define SUEPProd_Utilities_EtaPhiGrid_h
+
+#include <cmath>
+#include <vector>
+
+//! Binned eta-phi index for cone and nearest-neighbour queries over a set of points
+/*!
+ * Points are added with add() (their index is the order of addition) and sorted into square cells
+ * of size cellSize by build(). Queries visit only the cells overlapping the cone, so the cost scales
+ * with the local density instead of the total number of points. Points beyond |eta| = etaMax fall
+ * in the outermost cells. Cone queries include points with dR <= radius; nearest() requires
+ * dR < maxDR, returning the lowest index among equidistant points (same as a linear scan).
+ * Call clear(), add() and build() for each new set of points; the memory is reused.
+ */
+class EtaPhiGrid {
+ public:
+  EtaPhiGrid(double cellSize = 0.1, double etaMax = 5.);
+
+  void clear();
+  void reserve(unsigned);
+  //! Add a point and return its index
+  unsigned add(double eta, double phi);
+  //! Sort the points into the cells. Call after the last add() and before the queries.
+  void build();
+
+  unsigned size() const { return eta_.size(); }
+
+  //! Call f(index, dR2) for all points within the cone
+  template<class F>
+  void forEachInCone(double eta, double phi, double radius, F&& f) const;
+  //! Sum of weight(index) over the points within the cone
+  template<class Weight>
+  double coneSum(double eta, double phi, double radius, Weight&& weight) const;
+  //! Index of the nearest point with pred(index) == true and dR < maxDR, or -1
+  template<class Pred>
+  int nearest(double eta, double phi, double maxDR, Pred&& pred) const;
+
+  //! Delta phi in [-pi, pi]
+  static double deltaPhi(double phi1, double phi2) { return std::remainder(phi1 - phi2, 2. * M_PI); }
+
+ private:
+  unsigned etaBin_(double) const;
+  unsigned phiBin_(double) const;
+
+  double const cellSize_;
+  double const etaMax_;
+  unsigned const nEta_;
+  unsigned const nPhi_;
+  double const phiWidth_;
+
+  std::vector<float> eta_{};
+  std::vector<float> phi_{};
+  std::vector<unsigned> cellOf_{};
+  //! Points in cell c are [cellStart_[c], cellStart_[c + 1]) of the sorted arrays
+  std::vector<unsigned> cellStart_;
+  std::vector<unsigned> sortedIndex_{};
+  std::vector<float> sortedEta_{};
+  std::vector<float> sortedPhi_{};
+  std::vector<unsigned> nextPos_{}; //! work space of build()
+};
+
+template<class F>
+void
+EtaPhiGrid::forEachInCone(double _eta, double _phi, double _radius, F&& _f) const
+{
+  double dR2Max(_radius * _radius);
+
+  unsigned etaLow(etaBin_(_eta - _radius));
+  unsigned etaHigh(etaBin_(_eta + _radius));
+
+  // the center can be anywhere within its cell
+  int phiSpan(std::ceil(_radius / phiWidth_));
+  unsigned nPhiVisit(2 * phiSpan + 1);
+  int phiFirst(int(phiBin_(_phi)) - phiSpan);
+  if (nPhiVisit >= nPhi_) {
+    nPhiVisit = nPhi_;
+    phiFirst = 0;
+  }
+
+  for (unsigned iEta(etaLow); iEta <= etaHigh; ++iEta) {
+    for (unsigned iV(0); iV != nPhiVisit; ++iV) {
+      unsigned iPhi((phiFirst + int(iV) + int(nPhi_)) % nPhi_);
+      unsigned cell(iEta * nPhi_ + iPhi);
+
+      for (unsigned iP(cellStart_[cell]); iP != cellStart_[cell + 1]; ++iP) {
+        double dEta(sortedEta_[iP] - _eta);
+        double dPhi(deltaPhi(sortedPhi_[iP], _phi));
+        double dR2(dEta * dEta + dPhi * dPhi);
+        if (dR2 <= dR2Max)
+          _f(sortedIndex_[iP], dR2);
+      }
+    }
+  }
+}
+
+template<class Weight>
+double
+EtaPhiGrid::coneSum(double _eta, double _phi, double _radius, Weight&& _weight) const
+{
+  double sum(0.);
+  forEachInCone(_eta, _phi, _radius, [&sum, &_weight](unsigned _idx, double) { sum += _weight(_idx); });
+  return sum;
+}
+
+template<class Pred>
+int
+EtaPhiGrid::nearest(double _eta, double _phi, double _maxDR, Pred&& _pred) const
+{
+  int iMatch(-1);
+  double minDR2(_maxDR * _maxDR);
+
+  forEachInCone(_eta, _phi, _maxDR, [&](unsigned _idx, double _dR2) {
+      if (_dR2 > minDR2 || (_dR2 == minDR2 && (iMatch < 0 || int(_idx) > iMatch)))
+        return;
+      if (!_pred(_idx))
+        return;
+
+      minDR2 = _dR2;
+      iMatch = _idx;
+    });
+
+  return iMatch;
+}
+
+#endif
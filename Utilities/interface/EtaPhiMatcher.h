@@ -0,0 +1,51 @@
+#ifndef SUEPProd_Utilities_EtaPhiMatcher_h
+#define SUEPProd_Utilities_EtaPhiMatcher_h
+
+#include "EtaPhiGrid.h"
+
+#include <utility>
+#include <vector>
+
+//! Per-event eta-phi matching of query objects to a set of targets
+/*!
+ * Targets are set with clear(), addTarget() and build() (target index = order of addition) and
+ * stored in an EtaPhiGrid, so that each query only looks at the targets in its neighbourhood.
+ * Queries are passed as arrays; result[i] is the matched target index for query i, or -1.
+ *  . matchNearest: each query gets its nearest target with dR < maxDR. Targets can be shared.
+ *  . matchUnique: global best-match assignment. Pairs with dR < maxDR are assigned in increasing
+ *    dR order, each query and each target at most once.
+ *  . forEachInCone: all targets with dR <= radius, as in EtaPhiGrid.
+ * Ties are resolved toward lower indices, so results do not depend on the binning. The grid cell
+ * size should be comparable to the typical matching radius.
+ */
+class EtaPhiMatcher {
+ public:
+  EtaPhiMatcher(double cellSize = 0.4, double etaMax = 5.) : grid_(cellSize, etaMax) {}
+
+  void clear() { grid_.clear(); }
+  void reserve(unsigned n) { grid_.reserve(n); }
+  unsigned addTarget(double eta, double phi) { return grid_.add(eta, phi); }
+  void build() { grid_.build(); }
+
+  unsigned nTargets() const { return grid_.size(); }
+
+  void matchNearest(unsigned nQueries, float const* eta, float const* phi, double maxDR, int* result) const;
+  void matchUnique(unsigned nQueries, float const* eta, float const* phi, double maxDR, int* result);
+
+  template<class F>
+  void forEachInCone(double eta, double phi, double radius, F&& f) const { grid_.forEachInCone(eta, phi, radius, std::forward<F>(f)); }
+
+ private:
+  struct Pair {
+    float dR2;
+    unsigned query;
+    unsigned target;
+  };
+
+  EtaPhiGrid grid_;
+  //! work space of matchUnique
+  std::vector<Pair> pairs_{};
+  std::vector<char> targetUsed_{};
+};
+
+#endif
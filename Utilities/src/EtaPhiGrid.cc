@@ -0,0 +1,92 @@
+#include "../interface/EtaPhiGrid.h"
+
+#include <algorithm>
+
+EtaPhiGrid::EtaPhiGrid(double _cellSize/* = 0.1*/, double _etaMax/* = 5.*/) :
+  cellSize_(_cellSize),
+  etaMax_(_etaMax),
+  nEta_(std::max(1., std::ceil(2. * _etaMax / _cellSize))),
+  nPhi_(std::max(1., std::floor(2. * M_PI / _cellSize))),
+  phiWidth_(2. * M_PI / nPhi_),
+  cellStart_(nEta_ * nPhi_ + 1, 0)
+{
+}
+
+void
+EtaPhiGrid::clear()
+{
+  eta_.clear();
+  phi_.clear();
+  cellOf_.clear();
+  sortedIndex_.clear();
+  sortedEta_.clear();
+  sortedPhi_.clear();
+  std::fill(cellStart_.begin(), cellStart_.end(), 0);
+}
+
+void
+EtaPhiGrid::reserve(unsigned _n)
+{
+  eta_.reserve(_n);
+  phi_.reserve(_n);
+  cellOf_.reserve(_n);
+  sortedIndex_.reserve(_n);
+  sortedEta_.reserve(_n);
+  sortedPhi_.reserve(_n);
+}
+
+unsigned
+EtaPhiGrid::add(double _eta, double _phi)
+{
+  eta_.push_back(_eta);
+  phi_.push_back(_phi);
+  cellOf_.push_back(etaBin_(_eta) * nPhi_ + phiBin_(_phi));
+
+  return eta_.size() - 1;
+}
+
+void
+EtaPhiGrid::build()
+{
+  // counting sort by cell
+  std::fill(cellStart_.begin(), cellStart_.end(), 0);
+  for (unsigned cell : cellOf_)
+    ++cellStart_[cell + 1];
+
+  for (unsigned iC(1); iC != cellStart_.size(); ++iC)
+    cellStart_[iC] += cellStart_[iC - 1];
+
+  unsigned nPoints(eta_.size());
+  sortedIndex_.resize(nPoints);
+  sortedEta_.resize(nPoints);
+  sortedPhi_.resize(nPoints);
+
+  nextPos_.assign(cellStart_.begin(), cellStart_.end() - 1);
+  for (unsigned iP(0); iP != nPoints; ++iP) {
+    unsigned pos(nextPos_[cellOf_[iP]]++);
+    sortedIndex_[pos] = iP;
+    sortedEta_[pos] = eta_[iP];
+    sortedPhi_[pos] = phi_[iP];
+  }
+}
+
+unsigned
+EtaPhiGrid::etaBin_(double _eta) const
+{
+  if (!(_eta > -etaMax_)) // also catches NaN
+    return 0;
+
+  unsigned iEta((_eta + etaMax_) / cellSize_);
+  return std::min(iEta, nEta_ - 1);
+}
+
+unsigned
+EtaPhiGrid::phiBin_(double _phi) const
+{
+  double phi(std::remainder(_phi, 2. * M_PI) + M_PI); // [0, 2pi]
+  if (!(phi > 0.))
+    return 0;
+
+  unsigned iPhi(phi / phiWidth_);
+  return std::min(iPhi, nPhi_ - 1);
+}
@@ -0,0 +1,44 @@
+#include "../interface/EtaPhiMatcher.h"
+
+#include <algorithm>
+
+void
+EtaPhiMatcher::matchNearest(unsigned _nQueries, float const* _eta, float const* _phi, double _maxDR, int* _result) const
+{
+  for (unsigned iQ(0); iQ != _nQueries; ++iQ)
+    _result[iQ] = grid_.nearest(_eta[iQ], _phi[iQ], _maxDR, [](unsigned) { return true; });
+}
+
+void
+EtaPhiMatcher::matchUnique(unsigned _nQueries, float const* _eta, float const* _phi, double _maxDR, int* _result)
+{
+  double maxDR2(_maxDR * _maxDR);
+
+  pairs_.clear();
+  for (unsigned iQ(0); iQ != _nQueries; ++iQ) {
+    _result[iQ] = -1;
+
+    grid_.forEachInCone(_eta[iQ], _phi[iQ], _maxDR, [this, iQ, maxDR2](unsigned _iT, double _dR2) {
+        if (_dR2 < maxDR2)
+          pairs_.push_back(Pair{float(_dR2), iQ, _iT});
+      });
+  }
+
+  std::sort(pairs_.begin(), pairs_.end(), [](Pair const& _lhs, Pair const& _rhs) {
+      if (_lhs.dR2 != _rhs.dR2)
+        return _lhs.dR2 < _rhs.dR2;
+      if (_lhs.query != _rhs.query)
+        return _lhs.query < _rhs.query;
+      return _lhs.target < _rhs.target;
+    });
+
+  targetUsed_.assign(grid_.size(), 0);
+
+  for (auto& pair : pairs_) {
+    if (_result[pair.query] >= 0 || targetUsed_[pair.target])
+      continue;
+
+    _result[pair.query] = pair.target;
+    targetUsed_[pair.target] = 1;
+  }
+}